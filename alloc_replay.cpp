@@ -0,0 +1,715 @@
+/*
+Allocator replay benchmark. Replays a heap trace against every allocator we have and reports
+the time per call and the memory each one needed for it. Built twice from the same source,
+see the replay and replay-qemu targets in the Makefile:
+
+  host  (make replay)       g++ on the build machine, times with the TSC (steady_clock on
+                            anything that isn't x86), libc is glibc's malloc
+  QEMU  (make replay-qemu)  arm-none-eabi-g++ for the mps2-an386 board (a Cortex-M4F),
+                            linked with newlib (rdimon, semihosting for stdio and files) and
+                            qemu_mps2.ld. libc is newlib's malloc growing through _sbrk.
+                            Times with SysTick on the board's 25 MHz CPU clock. QEMU runs
+                            with -icount shift=5, every instruction takes 32 ns of virtual
+                            time, so a tick (40 ns) is an instruction and a quarter whatever
+                            the host does. Not cycles, but the same for every allocator
+
+usage: alloc_replay [trace.txt]
+
+The trace is what heap_trace_dump prints in a make HEAP_TRACE=1 build (heap.h), captured
+from the console. Several dumps can follow each other, the "last N of M heap calls" header
+tells where each one starts, calls already seen are skipped and calls that went through the
+ring between two dumps are counted as lost. Frees of blocks allocated before the capture
+are skipped. Without a trace a synthetic one is generated, mostly small blocks with a few
+large ones (up to 4K) and reallocs, in bursts of REPLAY_SYNTH_BURST calls that end with
+everything still live freed, like a request or a frame whose memory goes when it's done.
+
+Allocators:
+
+  libc   malloc/realloc/free
+  tlsf   tlsf.cpp over REPLAY_POOL_BYTES
+  pool   Pools of REPLAY_POOL_CLASSES size classes (16 bytes to 4K), a block from the smallest
+         class that fits, bigger requests fail. realloc within a class stays put
+  arena  Arena over REPLAY_POOL_BYTES, free only gives back the last block. When the last
+         live block goes the arena is reset, the end of a burst, so it's used the way an
+         arena per request or frame would be. A trace that never frees everything at once
+         runs it out
+
+Per allocator: average and worst time of an alloc (malloc and realloc) and of a free, the
+footprint (memory the allocator needed, its high water), the fragmentation and the number
+of failed calls. The footprint is the span from the lowest block to the highest block end
+for libc (newlib's heap starts at its first block and grows with _sbrk, so that's what
+_sbrk handed out), the highest block end in the pool for tlsf, the size class bytes in use
+at the peak for pool (what pools sized just right would need) and the peak used for arena.
+glibc's heap has the tool's own freed buffers and its per-thread caches in it, libc's span
+on the host is a rough number. Fragmentation is the part of the footprint that wasn't live
+data at the trace's peak, header overhead, rounding and holes together.
+
+An allocator that fails more than REPLAY_FAIL_PERMILLE of the allocs didn't run the trace,
+only the part of it that fit (pool given blocks above 4K, arena a trace without bursts).
+Its times, footprint and fragmentation describe a different workload, so its row shows
+only the failed count and a note under the table says how much of the trace it missed.
+
+Every allocator replays the trace REPLAY_PASSES times. The first pass pays for page faults
+and cold caches and a host's worst case catches whatever interrupt or reschedule hit it, so
+the averages are from the last pass and the worst case is the lowest of the passes' worst.
+*/
+
+#include "heap.h"
+#include "tlsf.h"
+#include "pool.h"
+#include "arena.h"
+#include <cstring>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#if defined (__arm__)
+#include "memory_map.h"
+#elif !defined (__x86_64__) && !defined (__i386__)
+#include <chrono>
+#endif
+
+#define REPLAY_POOL_BYTES     (512U * 1024U)
+#define REPLAY_PASSES         3U
+#define REPLAY_FAIL_PERMILLE  10U     /* more failed allocs than this and the row isn't comparable */
+#define REPLAY_SYNTH_OPS      20000U
+#define REPLAY_SYNTH_SLOTS    256U
+#define REPLAY_SYNTH_BURST    1000U   /* calls, then everything live is freed */
+#define REPLAY_LINE_MAX       160U
+
+/* ------------------------------------------------------------------------- */
+/* Clock                                                                      */
+/* ------------------------------------------------------------------------- */
+
+#if defined (__arm__)
+#define REPLAY_UNIT   "SysTick ticks"
+
+/* SysTick counts down from 2^24 - 1 and wraps, any one call takes a lot less */
+static void replay_clock_init(){
+  SysTick->LOAD = 0xFFFFFFU;
+  SysTick->VAL = 0;
+  SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk;
+}
+
+static inline std::uint32_t replay_clock(){
+  return 0xFFFFFFU - SysTick->VAL;
+}
+
+static inline std::uint32_t replay_elapsed(std::uint32_t start){
+  return (replay_clock() - start) & 0xFFFFFFU;
+}
+#elif defined (__x86_64__) || defined (__i386__)
+#define REPLAY_UNIT   "TSC cycles"
+
+static void replay_clock_init(){
+}
+
+static inline std::uint32_t replay_clock(){
+  return (std::uint32_t)__builtin_ia32_rdtsc();
+}
+
+static inline std::uint32_t replay_elapsed(std::uint32_t start){
+  return (std::uint32_t)__builtin_ia32_rdtsc() - start;
+}
+#else
+#define REPLAY_UNIT   "ns"
+
+static void replay_clock_init(){
+}
+
+static inline std::uint32_t replay_clock(){
+  return (std::uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline std::uint32_t replay_elapsed(std::uint32_t start){
+  return replay_clock() - start;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* QEMU board support                                                         */
+/* ------------------------------------------------------------------------- */
+
+#if defined (__arm__)
+/* newlib's crt0 (rdimon.specs) sets up the stack and .bss and calls main, the board only
+   needs the first vectors. The FPU is off out of reset, and code built with
+   -mfloat-abi=hard can use it anywhere */
+extern "C" void _start(void);
+extern std::uint32_t __stack;           /* Symbol defined in qemu_mps2.ld */
+
+[[noreturn]] static void replay_reset(){
+  SCB->CPACR |= (0xFU << 20);           /* CP10 and CP11 full access */
+  __DSB();
+  __ISB();
+  _start();
+  __builtin_unreachable();
+}
+
+[[noreturn]] static void replay_fault(){
+  _exit(3);
+}
+
+[[gnu::section(".isr_vector"), gnu::used]] static const std::uint32_t replay_vectors[16] = {
+  (std::uint32_t)&__stack, (std::uint32_t)&replay_reset,
+  (std::uint32_t)&replay_fault, (std::uint32_t)&replay_fault, (std::uint32_t)&replay_fault,
+  (std::uint32_t)&replay_fault, (std::uint32_t)&replay_fault, 0, 0, 0, 0,
+  (std::uint32_t)&replay_fault, (std::uint32_t)&replay_fault, 0,
+  (std::uint32_t)&replay_fault, (std::uint32_t)&replay_fault,
+};
+#endif /* __arm__ */
+
+/* ------------------------------------------------------------------------- */
+/* Trace                                                                      */
+/* ------------------------------------------------------------------------- */
+
+/* Blocks are numbered in the order the trace allocates them, a realloc that moves makes a
+   new one. old is the block a realloc starts from, REPLAY_NONE if it's not in the trace */
+#define REPLAY_NONE   0xFFFFFFFFU
+
+struct ReplayOp {
+  std::uint32_t op;       /* HEAP_OP_ALLOC, HEAP_OP_FREE or HEAP_OP_REALLOC */
+  std::uint32_t id;
+  std::uint32_t old;
+  std::uint32_t size;
+};
+
+struct ReplayTrace {
+  std::vector<ReplayOp> ops;
+  std::uint32_t blocks;
+  std::uint32_t lost;     /* calls that went through the ring between two dumps */
+  std::uint32_t skipped;  /* frees and reallocs of blocks from before the capture */
+};
+
+static bool replay_parse_op(const char *name, std::uint32_t *op){
+  static const char *const names[] = {"alloc", "free", "realloc"};
+  for(std::uint32_t i = 0; i < sizeof(names) / sizeof(names[0]); i++){
+    if(0 == std::strcmp(name, names[i])){
+      *op = i;
+      return true;
+    }
+  }
+  return false;                 /* FAILED, nothing happened to replay */
+}
+
+static bool replay_load(const char *path, ReplayTrace *trace){
+  FILE *f = std::fopen(path, "r");
+  if(nullptr == f){
+    return false;
+  }
+
+  std::unordered_map<unsigned long, std::uint32_t> live;   /* traced address to block */
+  unsigned long seen = 0;       /* calls read so far, counted like heap_trace.next */
+  unsigned long index = 0;
+  char line[REPLAY_LINE_MAX];
+
+  while(nullptr != std::fgets(line, sizeof(line), f)){
+    unsigned long count, total;
+    if(2 == std::sscanf(line, "last %lu of %lu heap calls", &count, &total)){
+      index = total - count;
+      if(index > seen){
+        trace->lost += (std::uint32_t)(index - seen);
+        seen = index;
+      }
+      continue;
+    }
+
+    unsigned long stamp, ptr, size, caller, was = 0;
+    char name[16];
+    if(5 != std::sscanf(line, "%lu %15s %lx %lu bytes from %lx", &stamp, name, &ptr, &size, &caller)){
+      continue;
+    }
+    if(index++ < seen){
+      continue;                 /* in the previous dump already */
+    }
+    seen = index;
+
+    std::uint32_t op;
+    if(!replay_parse_op(name, &op)){
+      continue;
+    }
+    const char *old = std::strstr(line, "was ");
+    if(nullptr != old){
+      was = std::strtoul(old + 4, nullptr, 16);
+    }
+
+    ReplayOp r = {op, REPLAY_NONE, REPLAY_NONE, (std::uint32_t)size};
+    if(HEAP_OP_FREE == op){
+      auto it = live.find(ptr);
+      if(live.end() == it){
+        trace->skipped++;
+        continue;
+      }
+      r.id = it->second;
+      live.erase(it);
+    }
+    else{
+      if(HEAP_OP_REALLOC == op){
+        auto it = live.find(was);
+        if(live.end() != it){
+          r.old = it->second;
+          live.erase(it);
+        }
+        else if(0 != was){
+          trace->skipped++;
+        }
+      }
+      if(0 == ptr){
+        if(REPLAY_NONE == r.old){
+          continue;             /* realloc to 0 bytes of a block we never saw */
+        }
+        r = {HEAP_OP_FREE, r.old, REPLAY_NONE, 0};    /* realloc to 0 bytes frees */
+      }
+      else{
+        if((HEAP_OP_REALLOC == op) && (REPLAY_NONE == r.old)){
+          r.op = HEAP_OP_ALLOC;
+        }
+        r.id = trace->blocks++;
+        live[ptr] = r.id;
+      }
+    }
+    trace->ops.push_back(r);
+  }
+
+  std::fclose(f);
+  return true;
+}
+
+/* Same xorshift as the heap benchmark in bench.cpp */
+static std::uint32_t replay_rand(std::uint32_t *state){
+  std::uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static void replay_synthesize(ReplayTrace *trace){
+  std::uint32_t slots[REPLAY_SYNTH_SLOTS];
+  std::uint32_t seed = 0x2545F491U;
+  for(std::uint32_t &s : slots){
+    s = REPLAY_NONE;
+  }
+
+  for(std::uint32_t n = 0; n < REPLAY_SYNTH_OPS; n++){
+    if((0 != n) && (0 == n % REPLAY_SYNTH_BURST)){
+      for(std::uint32_t &s : slots){
+        if(REPLAY_NONE != s){
+          trace->ops.push_back({HEAP_OP_FREE, s, REPLAY_NONE, 0});
+          s = REPLAY_NONE;
+        }
+      }
+    }
+
+    std::uint32_t r = replay_rand(&seed);
+    std::uint32_t &slot = slots[r % REPLAY_SYNTH_SLOTS];
+    /* 15 in 16 up to 256 bytes, the rest up to 4K */
+    std::uint32_t size = (0 != (r >> 28)) ? 8U + ((r >> 8) & 0xF8U) : 256U + ((r >> 8) & 0xF00U);
+
+    if(REPLAY_NONE == slot){
+      trace->ops.push_back({HEAP_OP_ALLOC, trace->blocks, REPLAY_NONE, size});
+      slot = trace->blocks++;
+    }
+    else if(0 == (r & 0x700U)){
+      trace->ops.push_back({HEAP_OP_REALLOC, trace->blocks, slot, size});
+      slot = trace->blocks++;
+    }
+    else{
+      trace->ops.push_back({HEAP_OP_FREE, slot, REPLAY_NONE, 0});
+      slot = REPLAY_NONE;
+    }
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Allocators                                                                 */
+/* ------------------------------------------------------------------------- */
+
+/* account is called after every call, outside the timing, with what came back (or went
+   back, freed set) and returns the footprint so far */
+struct ReplayAllocator {
+  const char *name;
+  void (*begin)(void);          /* before every pass, everything from the last one is freed */
+  void *(*alloc)(std::size_t size);
+  void *(*realloc)(void *ptr, std::size_t old_size, std::size_t size);
+  void (*free)(void *ptr, std::size_t size);
+  std::size_t (*account)(const void *ptr, std::size_t size, bool freed);
+};
+
+alignas(16) static std::uint8_t replay_mem[REPLAY_POOL_BYTES];
+
+/* libc */
+
+static void libc_begin(){
+}
+
+static void *libc_alloc(std::size_t size){
+  return std::malloc(size);
+}
+
+static void *libc_realloc(void *ptr, std::size_t old_size, std::size_t size){
+  (void)old_size;
+  return std::realloc(ptr, size);
+}
+
+static void libc_free(void *ptr, std::size_t size){
+  (void)size;
+  std::free(ptr);
+}
+
+/* The span from the lowest block to the highest block end */
+static std::size_t libc_account(const void *ptr, std::size_t size, bool freed){
+  static const std::uint8_t *low, *high;
+  const std::uint8_t *p = (const std::uint8_t *)ptr;
+  if(!freed && (nullptr != p)){
+    low = ((nullptr == low) || (p < low)) ? p : low;
+    high = (p + size > high) ? p + size : high;
+  }
+  return (std::size_t)(high - low);
+}
+
+/* tlsf */
+
+static Tlsf replay_tlsf;
+
+static void tlsf_begin(){
+  tlsf_init(&replay_tlsf);
+  tlsf_add_pool(&replay_tlsf, replay_mem, sizeof(replay_mem));
+}
+
+static void *tlsf_alloc(std::size_t size){
+  return tlsf_malloc(&replay_tlsf, size);
+}
+
+static void *tlsf_resize(void *ptr, std::size_t old_size, std::size_t size){
+  (void)old_size;
+  return tlsf_realloc(&replay_tlsf, ptr, size);
+}
+
+static void tlsf_release(void *ptr, std::size_t size){
+  (void)size;
+  tlsf_free(&replay_tlsf, ptr);
+}
+
+static std::size_t tlsf_account(const void *ptr, std::size_t size, bool freed){
+  (void)size;
+  static std::size_t high;
+  if(!freed && (nullptr != ptr)){
+    std::size_t end = (std::size_t)((const std::uint8_t *)ptr + tlsf_block_size(ptr) - replay_mem);
+    high = (end > high) ? end : high;
+  }
+  return high;
+}
+
+/* pool */
+
+template <std::size_t S>
+struct alignas(8) ReplayBlock {
+  std::uint8_t bytes[S];
+};
+
+#define REPLAY_POOL_CLASSES   9U
+
+static Pool<ReplayBlock<16>, 2048> pool_16;
+static Pool<ReplayBlock<32>, 2048> pool_32;
+static Pool<ReplayBlock<64>, 1024> pool_64;
+static Pool<ReplayBlock<128>, 512> pool_128;
+static Pool<ReplayBlock<256>, 256> pool_256;
+static Pool<ReplayBlock<512>, 128> pool_512;
+static Pool<ReplayBlock<1024>, 64> pool_1k;
+static Pool<ReplayBlock<2048>, 64> pool_2k;
+static Pool<ReplayBlock<4096>, 64> pool_4k;
+
+static std::size_t pool_class(std::size_t size){
+  std::size_t bytes = 16;
+  while((bytes < size) && (bytes < (16U << (REPLAY_POOL_CLASSES - 1U)))){
+    bytes <<= 1;
+  }
+  return (size <= bytes) ? bytes : 0;
+}
+
+static void pool_begin(){
+}
+
+static void *pool_alloc(std::size_t size){
+  switch(pool_class(size)){
+    case 16:  return pool_16.alloc();
+    case 32:  return pool_32.alloc();
+    case 64:  return pool_64.alloc();
+    case 128: return pool_128.alloc();
+    case 256: return pool_256.alloc();
+    case 512: return pool_512.alloc();
+    case 1024: return pool_1k.alloc();
+    case 2048: return pool_2k.alloc();
+    case 4096: return pool_4k.alloc();
+    default:  return nullptr;
+  }
+}
+
+static void pool_free(void *ptr, std::size_t size){
+  switch(pool_class(size)){
+    case 16:  pool_16.free(ptr);  break;
+    case 32:  pool_32.free(ptr);  break;
+    case 64:  pool_64.free(ptr);  break;
+    case 128: pool_128.free(ptr); break;
+    case 256: pool_256.free(ptr); break;
+    case 512: pool_512.free(ptr); break;
+    case 1024: pool_1k.free(ptr);  break;
+    case 2048: pool_2k.free(ptr);  break;
+    case 4096: pool_4k.free(ptr);  break;
+    default:  break;
+  }
+}
+
+static void *pool_realloc(void *ptr, std::size_t old_size, std::size_t size){
+  if((0 != size) && (pool_class(size) == pool_class(old_size))){
+    return ptr;
+  }
+  void *moved = pool_alloc(size);
+  if(nullptr != moved){
+    std::memcpy(moved, ptr, (old_size < size) ? old_size : size);
+    pool_free(ptr, old_size);
+  }
+  return moved;
+}
+
+static std::size_t pool_account(const void *ptr, std::size_t size, bool freed){
+  static std::size_t used, high;
+  if(nullptr != ptr){
+    used = freed ? used - pool_class(size) : used + pool_class(size);
+  }
+  high = (used > high) ? used : high;
+  return high;
+}
+
+/* arena */
+
+static Arena replay_arena(replay_mem, sizeof(replay_mem));
+static std::uint32_t arena_live;   /* blocks handed out and not freed */
+
+static void arena_begin(){
+  replay_arena.reset();
+  arena_live = 0;
+}
+
+static void *arena_alloc(std::size_t size){
+  void *ptr = replay_arena.alloc(size);
+  arena_live += (nullptr != ptr) ? 1U : 0U;
+  return ptr;
+}
+
+static void *arena_realloc(void *ptr, std::size_t old_size, std::size_t size){
+  void *moved = replay_arena.alloc(size);
+  if(nullptr != moved){
+    std::memcpy(moved, ptr, (old_size < size) ? old_size : size);
+  }
+  return moved;
+}
+
+/* The last live block going is the end of a burst, everything is dropped at once */
+static void arena_free(void *ptr, std::size_t size){
+  if(0 == --arena_live){
+    replay_arena.reset();
+    return;
+  }
+  replay_arena.release_last(ptr, size);
+}
+
+static std::size_t arena_account(const void *ptr, std::size_t size, bool freed){
+  (void)ptr;
+  (void)size;
+  (void)freed;
+  return replay_arena.peak_used();
+}
+
+static const ReplayAllocator replay_allocators[] = {
+#if defined (__arm__)
+  {"newlib", libc_begin, libc_alloc, libc_realloc, libc_free, libc_account},
+#else
+  {"libc", libc_begin, libc_alloc, libc_realloc, libc_free, libc_account},
+#endif
+  {"tlsf", tlsf_begin, tlsf_alloc, tlsf_resize, tlsf_release, tlsf_account},
+  {"pool", pool_begin, pool_alloc, pool_realloc, pool_free, pool_account},
+  {"arena", arena_begin, arena_alloc, arena_realloc, arena_free, arena_account},
+};
+
+/* ------------------------------------------------------------------------- */
+/* Replay                                                                     */
+/* ------------------------------------------------------------------------- */
+
+struct ReplayLatency {
+  std::uint64_t sum;
+  std::uint32_t count;
+  std::uint32_t max;
+};
+
+struct ReplayResult {
+  ReplayLatency alloc;
+  ReplayLatency free;
+  std::size_t footprint;
+  std::uint32_t failed;
+};
+
+static void replay_count(ReplayLatency *l, std::uint32_t t){
+  l->sum += t;
+  l->count++;
+  l->max = (t > l->max) ? t : l->max;
+}
+
+/* One pass over the trace, blocks and sizes have a slot per traced block */
+static void replay_pass(const ReplayAllocator &a, const ReplayTrace &trace, void **blocks,
+                        std::uint32_t *sizes, ReplayResult *result){
+  *result = {};
+  a.begin();
+
+  for(const ReplayOp &op : trace.ops){
+    void *old = (REPLAY_NONE != op.old) ? blocks[op.old] : nullptr;
+
+    if(HEAP_OP_FREE == op.op){
+      void *ptr = blocks[op.id];
+      if(nullptr == ptr){
+        continue;               /* its alloc failed */
+      }
+      std::uint32_t t = replay_clock();
+      a.free(ptr, sizes[op.id]);
+      replay_count(&result->free, replay_elapsed(t));
+      blocks[op.id] = nullptr;
+      result->footprint = a.account(ptr, sizes[op.id], true);
+      continue;
+    }
+
+    if((HEAP_OP_REALLOC == op.op) && (nullptr != old)){
+      std::uint32_t t = replay_clock();
+      void *ptr = a.realloc(old, sizes[op.old], op.size);
+      replay_count(&result->alloc, replay_elapsed(t));
+      if(nullptr == ptr){
+        result->failed++;       /* the old block stays, it's freed at the end of the pass */
+        continue;
+      }
+      a.account(old, sizes[op.old], true);
+      blocks[op.old] = nullptr;
+      blocks[op.id] = ptr;
+      sizes[op.id] = op.size;
+      result->footprint = a.account(ptr, op.size, false);
+      continue;
+    }
+
+    /* An alloc, or a realloc whose block failed to allocate */
+    std::uint32_t t = replay_clock();
+    void *ptr = a.alloc(op.size);
+    replay_count(&result->alloc, replay_elapsed(t));
+    if(nullptr == ptr){
+      result->failed++;
+      continue;
+    }
+    blocks[op.id] = ptr;
+    sizes[op.id] = op.size;
+    result->footprint = a.account(ptr, op.size, false);
+  }
+
+  for(std::uint32_t id = 0; id < trace.blocks; id++){
+    if(nullptr != blocks[id]){
+      a.free(blocks[id], sizes[id]);
+      a.account(blocks[id], sizes[id], true);
+      blocks[id] = nullptr;
+    }
+  }
+}
+
+/* Most bytes live at once, the same for every allocator */
+static std::size_t replay_peak_live(const ReplayTrace &trace, std::uint32_t *sizes){
+  std::size_t live = 0, peak = 0;
+  for(const ReplayOp &op : trace.ops){
+    if(REPLAY_NONE != op.old){
+      live -= sizes[op.old];
+      sizes[op.old] = 0;
+    }
+    if(HEAP_OP_FREE == op.op){
+      live -= sizes[op.id];
+      sizes[op.id] = 0;
+    }
+    else if(REPLAY_NONE != op.id){
+      sizes[op.id] = op.size;
+      live += op.size;
+    }
+    peak = (live > peak) ? live : peak;
+  }
+  return peak;
+}
+
+static unsigned long replay_avg(const ReplayLatency &l){
+  return (0 != l.count) ? (unsigned long)(l.sum / l.count) : 0;
+}
+
+int main(int argc, char **argv){
+  ReplayTrace trace = {};
+  const char *source = "synthetic";
+  if(argc > 1){
+    source = argv[1];
+    if(!replay_load(source, &trace)){
+      std::printf("can't read %s\n", source);
+      return 1;
+    }
+  }
+  else{
+    replay_synthesize(&trace);
+  }
+
+  std::uint32_t calls[3] = {};
+  for(const ReplayOp &op : trace.ops){
+    calls[op.op]++;
+  }
+
+  /* Everything the replay needs is allocated up front, libc's footprint is only the trace's */
+  std::vector<void *> blocks(trace.blocks, nullptr);
+  std::vector<std::uint32_t> sizes(trace.blocks, 0);
+  std::size_t peak_live = replay_peak_live(trace, sizes.data());
+
+  std::printf("trace %s: %lu calls (%lu alloc, %lu realloc, %lu free), peak live %lu bytes\n", source,
+              (unsigned long)trace.ops.size(), (unsigned long)calls[HEAP_OP_ALLOC],
+              (unsigned long)calls[HEAP_OP_REALLOC], (unsigned long)calls[HEAP_OP_FREE], (unsigned long)peak_live);
+  if((0 != trace.lost) || (0 != trace.skipped)){
+    std::printf("  %lu calls lost between dumps, %lu on blocks from before the capture\n",
+                (unsigned long)trace.lost, (unsigned long)trace.skipped);
+  }
+  std::printf("times in " REPLAY_UNIT "\n");
+  std::printf("allocator  alloc avg  alloc max  free avg  free max  footprint  frag  failed\n");
+
+  /* Every alloc and realloc call, what failed counts against */
+  std::uint32_t allocs = calls[HEAP_OP_ALLOC] + calls[HEAP_OP_REALLOC];
+  std::uint32_t skipped_rows = 0;
+
+  replay_clock_init();
+  for(const ReplayAllocator &a : replay_allocators){
+    ReplayResult result = {};
+    std::size_t footprint = 0;
+    std::uint32_t alloc_max = 0xFFFFFFFFU, free_max = 0xFFFFFFFFU;
+    for(std::uint32_t pass = 0; pass < REPLAY_PASSES; pass++){
+      replay_pass(a, trace, blocks.data(), sizes.data(), &result);
+      footprint = (result.footprint > footprint) ? result.footprint : footprint;
+      alloc_max = (result.alloc.max < alloc_max) ? result.alloc.max : alloc_max;
+      free_max = (result.free.max < free_max) ? result.free.max : free_max;
+    }
+
+    if((std::uint64_t)result.failed * 1000U > (std::uint64_t)allocs * REPLAY_FAIL_PERMILLE){
+      std::printf("%-9s  %9s  %9s  %8s  %8s  %9s  %5s  %6lu\n", a.name, "-", "-", "-", "-", "-", "-",
+                  (unsigned long)result.failed);
+      skipped_rows++;
+      continue;
+    }
+
+    /* per mille of the footprint that wasn't live data */
+    unsigned long frag = (footprint > peak_live) ? (unsigned long)((footprint - peak_live) * 1000U / footprint) : 0;
+    std::printf("%-9s  %9lu  %9lu  %8lu  %8lu  %9lu  %2lu.%lu%%  %6lu\n", a.name, replay_avg(result.alloc),
+                (unsigned long)alloc_max, replay_avg(result.free), (unsigned long)free_max,
+                (unsigned long)footprint, frag / 10, frag % 10, (unsigned long)result.failed);
+  }
+
+  if(0 != skipped_rows){
+    std::printf("- : more than %lu.%lu%% of the %lu allocs failed, the rest of the row would only cover the "
+                "part of the trace that fit\n", (unsigned long)(REPLAY_FAIL_PERMILLE / 10),
+                (unsigned long)(REPLAY_FAIL_PERMILLE % 10), (unsigned long)allocs);
+  }
+  return 0;
+}
@@ -0,0 +1,148 @@
+#ifndef __ARENA_H
+#define __ARENA_H
+
+#include "homa_base.h"
+#include "sysmem.h"
+#include <new>
+#include <utility>
+
+/*
+Bump pointer arena. An arena owns one block of memory, from a sysmem.h region (taken with
+region_alloc, so kept for good) or any buffer, and hands it out front to back. Nothing is
+freed on its own: reset() drops everything at once, rollback() everything after a mark().
+That makes an allocation a compare and an add, a free costs nothing, and there is no
+fragmentation as long as what's allocated together dies together.
+
+Destructors don't run on reset or rollback, put only objects in here that don't need them
+(or call them yourself). Not ISR safe, one arena per subsystem or task.
+
+  static Arena request_arena(MEM_REGION_CCM, 8 * 1024);
+
+  void handle_request(const Packet &p){
+    ArenaScope scope(request_arena);        // rolls back when it goes out of scope
+    Header *h = request_arena.create<Header>(p);
+    std::vector<Field, ArenaAllocator<Field>> fields{ArenaAllocator<Field>(request_arena)};
+    ...
+  }
+*/
+
+#define ARENA_ALIGN   alignof(std::max_align_t)
+
+struct ArenaMark {
+  std::uint8_t *top;
+};
+
+class Arena {
+public:
+  Arena(void *mem, std::size_t bytes)
+    : base((std::uint8_t *)mem), top(base), end(base + ((nullptr != mem) ? bytes : 0)), peak(base) {}
+
+  /* bytes out of region, an empty arena (every alloc fails) if the region is full */
+  Arena(MemRegion region, std::size_t bytes) : Arena(region_alloc(region, bytes, ARENA_ALIGN), bytes) {}
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  /* align is a power of 2, nullptr if it doesn't fit */
+  void *alloc(std::size_t size, std::size_t align = ARENA_ALIGN){
+    std::uintptr_t p = ((std::uintptr_t)top + align - 1) & ~(std::uintptr_t)(align - 1);
+    if((p > (std::uintptr_t)end) || (size > (std::uintptr_t)end - p)){
+      return nullptr;
+    }
+    top = (std::uint8_t *)(p + size);
+    peak = (top > peak) ? top : peak;
+    return (void *)p;
+  }
+
+  template <typename T, typename... Args>
+  T *create(Args &&...args){
+    void *ptr = alloc(sizeof(T), alignof(T));
+    return (nullptr != ptr) ? new(ptr) T(std::forward<Args>(args)...) : nullptr;
+  }
+
+  /* Give back ptr if it's the last thing allocated (a growing vector), ignored otherwise */
+  void release_last(void *ptr, std::size_t size){
+    if((std::uint8_t *)ptr + size == top){
+      top = (std::uint8_t *)ptr;
+    }
+  }
+
+  ArenaMark mark() const {
+    return {top};
+  }
+
+  /* Drop everything allocated since m */
+  void rollback(ArenaMark m){
+    top = m.top;
+  }
+
+  void reset(){
+    top = base;
+  }
+
+  std::size_t capacity() const {
+    return (std::size_t)(end - base);
+  }
+
+  std::size_t used() const {
+    return (std::size_t)(top - base);
+  }
+
+  /* Most ever used at once, to size the arena */
+  std::size_t peak_used() const {
+    return (std::size_t)(peak - base);
+  }
+
+private:
+  std::uint8_t *base;
+  std::uint8_t *top;
+  std::uint8_t *end;
+  std::uint8_t *peak;
+};
+
+/* Rolls the arena back to where it was when the scope was entered */
+class ArenaScope {
+public:
+  explicit ArenaScope(Arena &a) : arena(a), start(a.mark()) {}
+  ~ArenaScope(){ arena.rollback(start); }
+
+  ArenaScope(const ArenaScope &) = delete;
+  ArenaScope &operator=(const ArenaScope &) = delete;
+
+private:
+  Arena &arena;
+  ArenaMark start;
+};
+
+/* Standard allocator on top of an arena, for containers. There are no exceptions, running
+   out of arena traps and ends up in fault.cpp's crash record */
+template <typename T>
+struct ArenaAllocator {
+  using value_type = T;
+
+  Arena *arena;
+
+  explicit ArenaAllocator(Arena &a) : arena(&a) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+  T *allocate(std::size_t n){
+    void *ptr = arena->alloc(n * sizeof(T), alignof(T));
+    if(nullptr == ptr){
+      __builtin_trap();
+    }
+    return (T *)ptr;
+  }
+
+  void deallocate(T *ptr, std::size_t n){
+    arena->release_last(ptr, n * sizeof(T));
+  }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U> &other) const {
+    return arena == other.arena;
+  }
+};
+
+#endif
@@ -0,0 +1,655 @@
+#include "bench.h"
+
+#if defined (HOMA_BENCH)
+
+#include "memory_map.h"
+#include "sections.h"
+#include "startup.h"
+#include "clock.h"
+#include "irq.h"
+#include "heap.h"
+#include "pool.h"
+#include "arena.h"
+#include "syslock.h"
+#include "mpu.h"
+#include "console.h"
+#include "itm.h"
+
+/* ------------------------------------------------------------------------- */
+/* CCM vs SRAM1 under DMA load                                                */
+/* ------------------------------------------------------------------------- */
+
+#define CCM_BENCH_WORDS   1024U
+#define CCM_BENCH_PASSES  16U
+
+CcmBench ccm_bench;
+
+static std::uint32_t sram_buf[CCM_BENCH_WORDS];
+HOMA_CCM_BSS static std::uint32_t ccm_buf[CCM_BENCH_WORDS];
+
+/* DMA traffic source and sink, both in SRAM1 */
+static std::uint32_t dma_src;
+static std::uint32_t dma_dst;
+
+static std::uint32_t bench_touch(volatile std::uint32_t *buf){
+  std::uint32_t t = DWT_GetCycleCount();
+  for(std::uint32_t pass = 0; pass < CCM_BENCH_PASSES; pass++){
+    for(std::uint32_t i = 0; i < CCM_BENCH_WORDS; i++){
+      buf[i] = buf[i] + pass;
+    }
+  }
+  return DWT_GetCycleCount() - t;
+}
+
+/* Memory to memory is DMA2 only. Both addresses are fixed (no PINC/MINC) so the stream just
+   keeps reading and writing the same two SRAM1 words. A transfer is at most 0xFFFF words and
+   mem-to-mem can't run circular, so the completion interrupt re-arms it until bench_dma_stop,
+   the load covers the whole timed loop whatever the loop's speed */
+static volatile bool dma_load;
+
+static void bench_dma_arm(){
+  DMA2->LIFCR = 0x3DU; /* clear all stream 0 flags */
+  DMA2_Stream0->NDTR = 0xFFFFU;
+  DMA2_Stream0->CR  |= DMA_SxCR_EN;
+}
+
+/* Overrides the weak alias in startup.cpp */
+void DMA2_Stream0_Handler(void){
+  if(dma_load){
+    bench_dma_arm();
+  }
+  else{
+    DMA2->LIFCR = 0x3DU;
+  }
+}
+
+static void bench_dma_start(){
+  RCC->AHB1ENR |= RCC_AHB1ENR_DMA2EN;
+  DMA2_Stream0->CR = 0;
+  while(DMA2_Stream0->CR & DMA_SxCR_EN);
+
+  DMA2_Stream0->PAR  = (std::uint32_t)&dma_src;
+  DMA2_Stream0->M0AR = (std::uint32_t)&dma_dst;
+  DMA2_Stream0->FCR  = 0;
+  DMA2_Stream0->CR   = DMA_SxCR_DIR_1 | DMA_SxCR_PSIZE_1 | DMA_SxCR_MSIZE_1 | DMA_SxCR_PL | DMA_SxCR_TCIE;
+
+  dma_load = true;
+  NVIC_ClearPendingIRQ(DMA2_Stream0_IRQn);
+  NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+  bench_dma_arm();
+}
+
+static void bench_dma_stop(){
+  dma_load = false;
+  NVIC_DisableIRQ(DMA2_Stream0_IRQn);
+  DMA2_Stream0->CR &= ~DMA_SxCR_EN;
+  while(DMA2_Stream0->CR & DMA_SxCR_EN);
+  DMA2->LIFCR = 0x3DU;
+  NVIC_ClearPendingIRQ(DMA2_Stream0_IRQn);
+}
+
+void bench_ccm_vs_sram(){
+  ccm_bench.sram_idle = bench_touch(sram_buf);
+  ccm_bench.ccm_idle = bench_touch(ccm_buf);
+
+  bench_dma_start();
+  ccm_bench.sram_dma = bench_touch(sram_buf);
+  bench_dma_stop();
+
+  bench_dma_start();
+  ccm_bench.ccm_dma = bench_touch(ccm_buf);
+  bench_dma_stop();
+}
+
+/* ------------------------------------------------------------------------- */
+/* Interrupt entry latency, flash vs RAM handler                              */
+/* ------------------------------------------------------------------------- */
+
+#define IRQ_BENCH_RUNS  32U
+#define IRQ_BENCH_IRQN  HASH_RNG_IRQn   /* no HASH on the 429 and RNG stays off, so the line is free */
+
+IrqBench irq_bench;
+
+static volatile std::uint32_t irq_entry;
+
+/* Overrides the weak alias in startup.cpp, so this one is in flash and in the flash table */
+void HASH_RNG_Handler(void){
+  irq_entry = DWT->CYCCNT;
+}
+
+#ifdef VECT_TAB_SRAM
+HOMA_RAMFUNC static void irq_bench_ram_handler(void){
+  irq_entry = DWT->CYCCNT;
+}
+
+/* Stand-in driver for the irq.h bindings. isr is kept out of line like a real driver's
+   would be, so the trampoline's call is part of what's measured */
+struct IrqBenchDriver {
+  std::uint32_t count;
+
+  [[gnu::noinline]] void isr(){
+    irq_entry = DWT->CYCCNT;
+    count++;
+  }
+};
+
+static IrqBenchDriver irq_bench_driver;
+#endif /* VECT_TAB_SRAM */
+
+static std::uint32_t bench_irq_once(){
+  std::uint32_t best = 0xFFFFFFFFU;
+
+  for(std::uint32_t i = 0; i < IRQ_BENCH_RUNS; i++){
+    std::uint32_t t = DWT->CYCCNT;
+    NVIC->STIR = IRQ_BENCH_IRQN;
+    __DSB();
+    __ISB();
+    std::uint32_t latency = irq_entry - t;
+    if(latency < best){
+      best = latency;
+    }
+  }
+  return best;
+}
+
+void bench_irq_latency(){
+  NVIC_EnableIRQ(IRQ_BENCH_IRQN);
+
+#ifdef VECT_TAB_SRAM
+  std::uint32_t flash_vector = NVIC_GetVector(IRQ_BENCH_IRQN);
+  irq_bench.flash_handler = bench_irq_once();
+
+  NVIC_SetVector(IRQ_BENCH_IRQN, (std::uint32_t)&irq_bench_ram_handler);
+  irq_bench.ram_handler = bench_irq_once();
+
+  irq_bind<IRQ_BENCH_IRQN, &IrqBenchDriver::isr, irq_bench_driver>();
+  irq_bench.static_member = bench_irq_once();
+
+  irq_bind<IRQ_BENCH_IRQN, &IrqBenchDriver::isr>(irq_bench_driver);
+  irq_bench.object_member = bench_irq_once();
+
+  irq_bind<IRQ_BENCH_IRQN>([]{ irq_entry = DWT->CYCCNT; });
+  irq_bench.lambda = bench_irq_once();
+
+  NVIC_SetVector(IRQ_BENCH_IRQN, flash_vector);
+#else
+  irq_bench.flash_handler = bench_irq_once();
+#endif /* VECT_TAB_SRAM */
+
+  NVIC_DisableIRQ(IRQ_BENCH_IRQN);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Clock switch latency                                                       */
+/* ------------------------------------------------------------------------- */
+
+static_assert(CLOCK_SPEED_COUNT == 4, "ClockBench is sized for 4 operating points");
+
+ClockBench clock_bench;
+
+void bench_clock_switch(){
+  ClockSpeed start = clock_speed();
+
+  for(std::uint32_t from = 0; from < CLOCK_SPEED_COUNT; from++){
+    for(std::uint32_t to = 0; to < CLOCK_SPEED_COUNT; to++){
+      if(from == to){
+        continue;
+      }
+      clock_set_speed((ClockSpeed)from);
+      console_flush();          /* or the console's listener drains it in the timed switch */
+
+      std::uint32_t t = DWT_GetCycleCount();
+      clock_set_speed((ClockSpeed)to);
+      clock_bench.switch_cycles[from][to] = DWT_GetCycleCount() - t;
+    }
+  }
+
+  clock_set_speed(start);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Heap latency                                                               */
+/* ------------------------------------------------------------------------- */
+
+#define HEAP_BENCH_POOL   (32U * 1024U)
+#define HEAP_BENCH_SEED   0x2545F491U
+
+HeapBench heap_bench;
+
+static Tlsf heap_bench_tlsf;
+static void *heap_bench_ptrs[HEAP_BENCH_SLOTS];
+
+static void *bench_tlsf_malloc(std::size_t size){
+  return tlsf_malloc(&heap_bench_tlsf, size);
+}
+
+static void bench_tlsf_free(void *ptr){
+  tlsf_free(&heap_bench_tlsf, ptr);
+}
+
+static std::uint32_t bench_xorshift(std::uint32_t *state){
+  std::uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+/* A random slot is freed if it holds something and filled otherwise, so the heap sits at
+   about half of HEAP_BENCH_SLOTS live blocks of mixed sizes, or of fixed_size if not 0 */
+static void bench_heap_run(void *(*alloc)(std::size_t), void (*release)(void *), std::size_t fixed_size,
+                           HeapLatency *out){
+  std::uint32_t state = HEAP_BENCH_SEED;
+  std::uint32_t mallocs = 0, frees = 0, malloc_sum = 0, free_sum = 0;
+  HeapLatency r = {};
+
+  for(std::uint32_t i = 0; i < HEAP_BENCH_OPS; i++){
+    std::uint32_t rnd = bench_xorshift(&state);
+    void *&slot = heap_bench_ptrs[rnd % HEAP_BENCH_SLOTS];
+
+    if(nullptr != slot){
+      std::uint32_t t = DWT_GetCycleCount();
+      release(slot);
+      t = DWT_GetCycleCount() - t;
+      slot = nullptr;
+      free_sum += t;
+      frees++;
+      r.free_max = (t > r.free_max) ? t : r.free_max;
+    }
+    else{
+      std::size_t size = (0 == (rnd & (7U << 8))) ? 8 + ((rnd >> 16) & 2047U) : 8 + ((rnd >> 16) & 255U);
+      size = (0 != fixed_size) ? fixed_size : size;
+      std::uint32_t t = DWT_GetCycleCount();
+      slot = alloc(size);
+      t = DWT_GetCycleCount() - t;
+      malloc_sum += t;
+      mallocs++;
+      r.malloc_max = (t > r.malloc_max) ? t : r.malloc_max;
+      r.failed += (nullptr == slot);
+    }
+  }
+
+  for(void *&slot : heap_bench_ptrs){
+    release(slot);
+    slot = nullptr;
+  }
+
+  r.malloc_avg = mallocs ? malloc_sum / mallocs : 0;
+  r.free_avg = frees ? free_sum / frees : 0;
+  *out = r;
+}
+
+void bench_heap_latency(){
+  static void *pool = region_alloc(MEM_REGION_SRAM, HEAP_BENCH_POOL, TLSF_ALIGN);
+  if(nullptr == pool){
+    return;
+  }
+
+  tlsf_init(&heap_bench_tlsf);
+  tlsf_add_pool(&heap_bench_tlsf, pool, HEAP_BENCH_POOL);
+  bench_heap_run(bench_tlsf_malloc, bench_tlsf_free, 0, &heap_bench.tlsf);
+  bench_heap_run(bench_tlsf_malloc, bench_tlsf_free, 0, &heap_bench.tlsf);
+
+  bench_heap_run(malloc, free, 0, &heap_bench.libc);
+  bench_heap_run(malloc, free, 0, &heap_bench.libc);
+
+#if defined (HOMA_MALLOC_NEWLIB)
+  heap_bench.libc_is_tlsf = 0;
+#else
+  heap_bench.libc_is_tlsf = 1;
+#endif /* HOMA_MALLOC_NEWLIB */
+}
+
+/* ------------------------------------------------------------------------- */
+/* Block pool                                                                 */
+/* ------------------------------------------------------------------------- */
+
+#define POOL_BENCH_ROUNDS   64U
+
+struct BenchBlock {
+  std::uint8_t bytes[POOL_BENCH_BYTES];
+};
+
+PoolBench pool_bench;
+
+static Pool<BenchBlock, HEAP_BENCH_SLOTS> bench_block_pool;
+
+static void *volatile bench_sink;
+
+static void *bench_pool_alloc(std::size_t){
+  return bench_block_pool.alloc();
+}
+
+static void bench_pool_free(void *ptr){
+  bench_block_pool.free(ptr);
+}
+
+/* Cycles per alloc/free pair, POOL_BENCH_BURST allocs then as many frees */
+static std::uint32_t bench_burst(void *(*alloc)(std::size_t), void (*release)(void *)){
+  void *blocks[POOL_BENCH_BURST];
+  std::uint32_t t = DWT_GetCycleCount();
+  for(std::uint32_t round = 0; round < POOL_BENCH_ROUNDS; round++){
+    for(void *&b : blocks){
+      b = alloc(POOL_BENCH_BYTES);
+    }
+    for(void *b : blocks){
+      release(b);
+    }
+  }
+  return (DWT_GetCycleCount() - t) / (POOL_BENCH_ROUNDS * POOL_BENCH_BURST);
+}
+
+void bench_pool(){
+  bench_heap_run(bench_pool_alloc, bench_pool_free, POOL_BENCH_BYTES, &pool_bench.pool);
+  bench_heap_run(malloc, free, POOL_BENCH_BYTES, &pool_bench.libc);
+  bench_heap_run(malloc, free, POOL_BENCH_BYTES, &pool_bench.libc);
+
+  pool_bench.pool_burst = bench_burst(bench_pool_alloc, bench_pool_free);
+  pool_bench.libc_burst = bench_burst(malloc, free);
+
+  static Arena arena(MEM_REGION_SRAM, POOL_BENCH_BURST * POOL_BENCH_BYTES);
+  std::uint32_t t = DWT_GetCycleCount();
+  for(std::uint32_t round = 0; round < POOL_BENCH_ROUNDS; round++){
+    for(std::uint32_t i = 0; i < POOL_BENCH_BURST; i++){
+      bench_sink = arena.alloc(POOL_BENCH_BYTES);
+    }
+    arena.reset();
+  }
+  pool_bench.arena_burst = (DWT_GetCycleCount() - t) / (POOL_BENCH_ROUNDS * POOL_BENCH_BURST);
+}
+
+/* ------------------------------------------------------------------------- */
+/* libc locks and reentrancy                                                  */
+/* ------------------------------------------------------------------------- */
+
+#define SYSLOCK_BENCH_RUNS   256U
+
+SyslockBench syslock_bench;
+
+static struct _reent bench_reent[2];
+
+void bench_syslock(){
+  std::uint32_t t = DWT_GetCycleCount();
+  for(std::uint32_t i = 0; i < SYSLOCK_BENCH_RUNS; i++){
+    __malloc_lock(_REENT);
+    __malloc_unlock(_REENT);
+  }
+  syslock_bench.lock_pair = (DWT_GetCycleCount() - t) / SYSLOCK_BENCH_RUNS;
+
+  __malloc_lock(_REENT);
+  t = DWT_GetCycleCount();
+  for(std::uint32_t i = 0; i < SYSLOCK_BENCH_RUNS; i++){
+    __malloc_lock(_REENT);
+    __malloc_unlock(_REENT);
+  }
+  syslock_bench.lock_nested = (DWT_GetCycleCount() - t) / SYSLOCK_BENCH_RUNS;
+  __malloc_unlock(_REENT);
+
+  /* The barrier keeps every store to _impure_ptr, and costs the same in both loops */
+  struct _reent *startup = _impure_ptr;
+  syslock_reent_init(&bench_reent[0]);
+  syslock_reent_init(&bench_reent[1]);
+
+  t = DWT_GetCycleCount();
+  for(std::uint32_t i = 0; i < SYSLOCK_BENCH_RUNS; i++){
+    asm volatile("" ::: "memory");
+  }
+  std::uint32_t empty = DWT_GetCycleCount() - t;
+
+  t = DWT_GetCycleCount();
+  for(std::uint32_t i = 0; i < SYSLOCK_BENCH_RUNS; i++){
+    syslock_reent_switch(&bench_reent[i & 1]);
+    asm volatile("" ::: "memory");
+  }
+  std::uint32_t swapped = DWT_GetCycleCount() - t;
+  syslock_reent_switch(startup);
+
+  syslock_bench.reent_switch = (swapped > empty) ? (swapped - empty) / SYSLOCK_BENCH_RUNS : 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* MPU stack guards                                                           */
+/* ------------------------------------------------------------------------- */
+
+#define MPU_BENCH_RUNS   256U
+
+MpuBench mpu_bench;
+
+/* Stand-ins for two task stacks' guards, never touched */
+alignas(MPU_GUARD_BYTES) static std::uint8_t bench_guard[2][MPU_GUARD_BYTES];
+
+void bench_mpu(){
+  std::uint32_t guards[2] = {mpu_guard_address(bench_guard[0]), mpu_guard_address(bench_guard[1])};
+
+  std::uint32_t t = DWT_GetCycleCount();
+  for(std::uint32_t i = 0; i < MPU_BENCH_RUNS; i++){
+    asm volatile("" : : "r"(guards[i & 1]) : "memory");
+  }
+  std::uint32_t empty = DWT_GetCycleCount() - t;
+
+  t = DWT_GetCycleCount();
+  for(std::uint32_t i = 0; i < MPU_BENCH_RUNS; i++){
+    mpu_guard_switch(guards[i & 1]);
+    asm volatile("" : : "r"(guards[i & 1]) : "memory");
+  }
+  std::uint32_t switched = DWT_GetCycleCount() - t;
+  mpu_guard_task_off();
+
+  mpu_bench.guard_switch = (switched > empty) ? (switched - empty) / MPU_BENCH_RUNS : 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* DMA console                                                                */
+/* ------------------------------------------------------------------------- */
+
+#define CONSOLE_BENCH_LINE    64U
+#define CONSOLE_BENCH_LINES   8U      /* fits in the ring */
+#define CONSOLE_BENCH_FLOOD   32U     /* doesn't */
+
+static_assert(CONSOLE_BENCH_LINE * CONSOLE_BENCH_LINES <= CONSOLE_TX_BYTES, "bench lines don't fit the console ring");
+
+ConsoleBench console_bench;
+
+static const char console_bench_line[CONSOLE_BENCH_LINE + 1] =
+  "console bench 0123456789abcdefghijklmnopqrstuvwxyz0123456789...\n";
+
+void bench_console(){
+  console_flush();
+
+  std::uint32_t t = DWT_GetCycleCount();
+  console_write_polled(console_bench_line, CONSOLE_BENCH_LINE);
+  console_bench.polled = DWT_GetCycleCount() - t;
+
+  std::uint32_t sum = 0, max = 0;
+  std::uint32_t start = DWT_GetCycleCount();
+  for(std::uint32_t i = 0; i < CONSOLE_BENCH_LINES; i++){
+    t = DWT_GetCycleCount();
+    console_write(console_bench_line, CONSOLE_BENCH_LINE);
+    t = DWT_GetCycleCount() - t;
+    sum += t;
+    max = (t > max) ? t : max;
+  }
+  console_flush();
+  console_bench.drain = DWT_GetCycleCount() - start;
+  console_bench.write_avg = sum / CONSOLE_BENCH_LINES;
+  console_bench.write_max = max;
+  /* bytes * (hclk / 1000) / (cycles / 1000), stays in 32 bits */
+  std::uint32_t drain_k = (console_bench.drain / 1000U) ? console_bench.drain / 1000U : 1U;
+  console_bench.throughput = CONSOLE_BENCH_LINE * CONSOLE_BENCH_LINES * (clock_freqs().hclk / 1000U) / drain_k;
+
+  ConsoleOverflow policy = console_set_overflow(CONSOLE_OVERFLOW_OVERWRITE);
+  max = 0;
+  for(std::uint32_t i = 0; i < CONSOLE_BENCH_FLOOD; i++){
+    t = DWT_GetCycleCount();
+    console_write(console_bench_line, CONSOLE_BENCH_LINE);
+    t = DWT_GetCycleCount() - t;
+    max = (t > max) ? t : max;
+  }
+  console_bench.overwrite_max = max;
+  console_flush();
+
+  console_set_overflow(CONSOLE_OVERFLOW_DROP);
+  std::uint32_t dropped = console_stats().dropped;
+  for(std::uint32_t i = 0; i < CONSOLE_BENCH_FLOOD; i++){
+    console_write(console_bench_line, CONSOLE_BENCH_LINE);
+  }
+  console_bench.dropped = console_stats().dropped - dropped;
+  console_flush();
+  console_set_overflow(policy);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ITM words vs ITM_SendChar                                                  */
+/* ------------------------------------------------------------------------- */
+
+#define ITM_BENCH_LINE   64U
+
+ItmBench itm_bench;
+
+static const char itm_bench_line[ITM_BENCH_LINE + 1] =
+  "itm bench 0123456789abcdefghijklmnopqrstuvwxyz0123456789.......\n";
+
+static void itm_bench_idle(){
+  while(ITM->TCR & ITM_TCR_BUSY_Msk);
+}
+
+void bench_itm(){
+  itm_bench_idle();
+  std::uint32_t t = DWT_GetCycleCount();
+  itm_send_word(ITM_PORT_METRICS, t);
+  itm_bench.word = DWT_GetCycleCount() - t;
+
+  itm_bench_idle();
+  t = DWT_GetCycleCount();
+  itm_write(ITM_PORT_LOG, itm_bench_line, ITM_BENCH_LINE);
+  itm_bench.line_words = DWT_GetCycleCount() - t;
+
+  /* ITM_SendChar only knows port 0 */
+  itm_bench_idle();
+  t = DWT_GetCycleCount();
+  for(std::uint32_t i = 0; i < ITM_BENCH_LINE; i++){
+    ITM_SendChar((std::uint32_t)itm_bench_line[i]);
+  }
+  itm_bench.line_bytes = DWT_GetCycleCount() - t;
+}
+
+#if defined (DATA_IN_ExtSDRAM)
+/* ------------------------------------------------------------------------- */
+/* SRAM vs SDRAM bandwidth                                                    */
+/* ------------------------------------------------------------------------- */
+
+#define SDRAM_BENCH_BYTES   4096U
+#define SDRAM_BENCH_WORDS   (SDRAM_BENCH_BYTES / sizeof(std::uint32_t))
+
+/* The SRAM copy goes into the CCM benchmark's SRAM buffer */
+static_assert(sizeof(sram_buf) >= SDRAM_BENCH_BYTES, "sram_buf too small for the SDRAM benchmark");
+
+SdramBench sdram_bench;
+
+static std::uint32_t sdram_bench_sram[SDRAM_BENCH_WORDS];
+HOMA_SDRAM static std::uint32_t sdram_bench_sdram[SDRAM_BENCH_WORDS];
+/* Copy source, in SDRAM for the SDRAM copy (SDRAM to SDRAM), in SRAM for the SRAM one */
+HOMA_SDRAM static std::uint32_t sdram_bench_sdram_src[SDRAM_BENCH_WORDS];
+
+static std::uint32_t bench_read(const volatile std::uint32_t *buf){
+  std::uint32_t sum = 0;
+  std::uint32_t t = DWT_GetCycleCount();
+  for(std::uint32_t i = 0; i < SDRAM_BENCH_WORDS; i++){
+    sum += buf[i];
+  }
+  t = DWT_GetCycleCount() - t;
+  (void)sum;
+  return t;
+}
+
+static std::uint32_t bench_write(volatile std::uint32_t *buf){
+  std::uint32_t t = DWT_GetCycleCount();
+  for(std::uint32_t i = 0; i < SDRAM_BENCH_WORDS; i++){
+    buf[i] = i;
+  }
+  return DWT_GetCycleCount() - t;
+}
+
+static std::uint32_t bench_copy(void *dst, const void *src){
+  std::uint32_t t = DWT_GetCycleCount();
+  boot_copy(dst, src, SDRAM_BENCH_BYTES);
+  return DWT_GetCycleCount() - t;
+}
+
+void bench_sdram_bandwidth(){
+  /* Write first, SDRAM holds garbage after power on */
+  sdram_bench.sram_write = bench_write(sdram_bench_sram);
+  sdram_bench.sram_read = bench_read(sdram_bench_sram);
+  sdram_bench.sram_copy = bench_copy(sram_buf, sdram_bench_sram);
+
+  sdram_bench.sdram_write = bench_write(sdram_bench_sdram);
+  sdram_bench.sdram_read = bench_read(sdram_bench_sdram);
+  bench_write(sdram_bench_sdram_src);
+  sdram_bench.sdram_copy = bench_copy(sdram_bench_sdram, sdram_bench_sdram_src);
+}
+
+#define SDRAM_TUNE_TEST_BYTES   (64U * 1024U)
+
+SdramTuneBench sdram_tune_bench;
+
+/* What sdram_test may wipe, other HOMA_SDRAM data and SDRAM heap pools stay untouched */
+HOMA_SDRAM static std::uint32_t sdram_tune_scratch[SDRAM_TUNE_TEST_BYTES / sizeof(std::uint32_t)];
+
+static std::uint8_t bench_less(std::uint8_t clocks, std::uint32_t k){
+  return (clocks > k) ? (std::uint8_t)(clocks - k) : 1U;
+}
+
+void bench_sdram_tune(){
+  for(std::uint32_t k = 0; k < SDRAM_TUNE_STEPS; k++){
+    SdramTiming t = sdram_default_timing;
+    t.txsr = bench_less(t.txsr, k);
+    t.tras = bench_less(t.tras, k);
+    t.trc = bench_less(t.trc, k);
+    t.trp = bench_less(t.trp, k);
+    t.trcd = bench_less(t.trcd, k);
+
+    sdram_set_timing(t);
+    sdram_tune_bench.timing[k] = t;
+    sdram_tune_bench.fail_addr[k] = 0;
+    sdram_tune_bench.passed[k] = sdram_test(sdram_tune_scratch, SDRAM_TUNE_TEST_BYTES,
+                                                  &sdram_tune_bench.fail_addr[k]);
+    sdram_tune_bench.copy_cycles[k] = bench_copy(sdram_bench_sdram, sdram_bench_sdram_src);
+  }
+
+  sdram_set_timing(sdram_default_timing);
+}
+#endif /* DATA_IN_ExtSDRAM */
+
+/* ------------------------------------------------------------------------- */
+/* Deferred .bss                                                              */
+/* ------------------------------------------------------------------------- */
+
+void bench_deferred_zero(){
+  std::uint32_t t = DWT_GetCycleCount();
+  boot_deferred_zero_finish();
+  boot_bench.deferred_zero = DWT_GetCycleCount() - t;
+}
+
+void bench_run_all(){
+  bench_deferred_zero();
+
+  DWT_EnableCycleCounter();
+  bench_ccm_vs_sram();
+  bench_irq_latency();
+  bench_clock_switch();
+  bench_heap_latency();
+  bench_pool();
+  bench_syslock();
+  bench_mpu();
+  bench_console();
+  bench_itm();
+#if defined (DATA_IN_ExtSDRAM)
+  if(sdram_ready()){
+    bench_sdram_tune();
+    bench_sdram_bandwidth();
+  }
+#endif /* DATA_IN_ExtSDRAM */
+}
+
+#endif /* HOMA_BENCH */
@@ -0,0 +1,210 @@
+#ifndef __BENCH_H
+#define __BENCH_H
+
+#include "homa_base.h"
+
+#if defined (DATA_IN_ExtSDRAM)
+#include "sdram.h"
+#endif /* DATA_IN_ExtSDRAM */
+
+/*
+On target benchmarks, only compiled in with HOMA_BENCH (make bench). Every benchmark
+times its work with the DWT cycle counter and leaves the result in a global struct so
+it can be read with a debugger (or printed once a console is up).
+*/
+
+#if defined (HOMA_BENCH)
+
+/* CPU read/write loop over a buffer in SRAM1 vs the same loop over a buffer in CCM,
+   once with the bus idle and once while a DMA2 memory to memory transfer hammers SRAM1. The
+   transfer is re-armed from its completion interrupt, so it runs for the whole loop; the
+   *_dma figures include those few interrupts */
+struct CcmBench {
+  std::uint32_t sram_idle;
+  std::uint32_t sram_dma;
+  std::uint32_t ccm_idle;
+  std::uint32_t ccm_dma;
+};
+
+extern CcmBench ccm_bench;
+
+void bench_ccm_vs_sram();
+
+/* Interrupt entry latency, cycles from the NVIC->STIR write that pends the IRQ to the
+   first instruction of the handler. Best of IRQ_BENCH_RUNS. The RAM handler (and the
+   RAM vector fetch) can only be measured with VECT_TAB_SRAM, otherwise it stays 0.
+   So do the irq.h bindings, which are timed up to the first instruction of the bound
+   member function or lambda and compare against flash_handler */
+struct IrqBench {
+  std::uint32_t flash_handler;
+  std::uint32_t ram_handler;
+  std::uint32_t static_member;   /* irq_bind<N, Member, Object>() */
+  std::uint32_t object_member;   /* irq_bind<N, Member>(object) */
+  std::uint32_t lambda;          /* irq_bind<N>([]{ ... }) */
+};
+
+extern IrqBench irq_bench;
+
+void bench_irq_latency();
+
+/* Cycles spent in clock_set_speed for every from/to pair of operating points. The console
+   is flushed before each timed switch so its listener finds nothing to drain. The DWT
+   counter runs on HCLK, which is the old clock at the start of the switch, the 16 MHz HSI
+   in the middle (PLL lock, most of the time) and the new clock at the end, so it's roughly
+   16 cycles per us */
+struct ClockBench {
+  std::uint32_t switch_cycles[4][4];   /* [from][to], indexed by ClockSpeed */
+};
+
+extern ClockBench clock_bench;
+
+void bench_clock_switch();
+
+/* malloc/free latency in cycles, worst and average over HEAP_BENCH_OPS random allocations
+   and frees (8 to 256 bytes, every 8th up to 2K, at most HEAP_BENCH_SLOTS live). The tlsf
+   numbers run tlsf.h directly on a pool of its own, the libc numbers go through malloc and
+   free, which is newlib-nano's first fit in a MALLOC=newlib build and heap.cpp's TLSF heap
+   otherwise. Both run the same sequence twice and time the second run, so growing the
+   heap isn't counted */
+#define HEAP_BENCH_OPS     4096U
+#define HEAP_BENCH_SLOTS   64U
+
+struct HeapLatency {
+  std::uint32_t malloc_max;
+  std::uint32_t malloc_avg;
+  std::uint32_t free_max;
+  std::uint32_t free_avg;
+  std::uint32_t failed;     /* mallocs that returned nullptr */
+};
+
+struct HeapBench {
+  HeapLatency tlsf;
+  HeapLatency libc;
+  std::uint32_t libc_is_tlsf;
+};
+
+extern HeapBench heap_bench;
+
+void bench_heap_latency();
+
+/* Pool<T, N> (pool.h) against malloc for a POOL_BENCH_BYTES object. latency is the
+   HeapBench sequence with every request that size, burst is cycles per alloc/free pair
+   when POOL_BENCH_BURST blocks are taken and given back in a row. arena_burst is the same
+   burst from an Arena (arena.h), given back with a single reset */
+#define POOL_BENCH_BYTES   64U
+#define POOL_BENCH_BURST   16U
+
+struct PoolBench {
+  HeapLatency pool;
+  HeapLatency libc;
+  std::uint32_t pool_burst;
+  std::uint32_t libc_burst;
+  std::uint32_t arena_burst;
+};
+
+extern PoolBench pool_bench;
+
+void bench_pool();
+
+/* syslock.h costs in cycles: an outermost __malloc_lock/__malloc_unlock pair, a pair nested
+   in another, and what syslock_reent_switch adds to a context switch (a loop swapping
+   _impure_ptr between two tasks' _reent against the same loop without it, per switch) */
+struct SyslockBench {
+  std::uint32_t lock_pair;
+  std::uint32_t lock_nested;
+  std::uint32_t reent_switch;
+};
+
+extern SyslockBench syslock_bench;
+
+void bench_syslock();
+
+/* What mpu_guard_switch adds to a context switch in cycles, a loop moving the task guard
+   between two stacks against the same loop without it, per switch */
+struct MpuBench {
+  std::uint32_t guard_switch;
+};
+
+extern MpuBench mpu_bench;
+
+void bench_mpu();
+
+/* Console (console.h) in cycles. write_avg / write_max: console_write of one
+   CONSOLE_BENCH_LINE byte line with room in the ring, what a printf caller waits for now.
+   polled: the same line sent polled, what it used to wait for. drain: CONSOLE_BENCH_LINES
+   lines written back to back until they're all on the wire, throughput in bytes per second
+   from that (the wire's limit is CONSOLE_BAUD / 10). overwrite_max: worst console_write
+   with the ring full under CONSOLE_OVERFLOW_OVERWRITE, dropped: bytes lost writing
+   CONSOLE_BENCH_FLOOD lines under CONSOLE_OVERFLOW_DROP */
+struct ConsoleBench {
+  std::uint32_t write_avg;
+  std::uint32_t write_max;
+  std::uint32_t polled;
+  std::uint32_t drain;
+  std::uint32_t throughput;
+  std::uint32_t overwrite_max;
+  std::uint32_t dropped;
+};
+
+extern ConsoleBench console_bench;
+
+void bench_console();
+
+/* ITM (itm.h) in cycles, each from an idle ITM. word: one itm_send_word. line_words: a
+   ITM_BENCH_LINE byte line through itm_write, line_bytes: the same line a byte at a time with
+   ITM_SendChar. Both lines are paced by the SWO pin once the ITM FIFO fills */
+struct ItmBench {
+  std::uint32_t word;
+  std::uint32_t line_words;
+  std::uint32_t line_bytes;
+};
+
+extern ItmBench itm_bench;
+
+void bench_itm();
+
+#if defined (DATA_IN_ExtSDRAM)
+/* Cycles to read, write and copy SDRAM_BENCH_BYTES in SRAM1 vs the same in SDRAM. read and
+   write are plain word loops, copy is boot_copy (4 word LDM/STM bursts) */
+struct SdramBench {
+  std::uint32_t sram_read;
+  std::uint32_t sram_write;
+  std::uint32_t sram_copy;
+  std::uint32_t sdram_read;
+  std::uint32_t sdram_write;
+  std::uint32_t sdram_copy;
+};
+
+extern SdramBench sdram_bench;
+
+void bench_sdram_bandwidth();
+
+/* SDTR tuning. Step k takes k clocks off every timing derived from the datasheet ns values
+   (TXSR, TRAS, TRC, TRP, TRCD, not below 1), then runs sdram_test over a scratch buffer of
+   SDRAM_TUNE_TEST_BYTES in .sdram and times an SDRAM to SDRAM copy. The fastest step that
+   passes is a candidate for sdram_is42s16400j on this board. Only the scratch buffer and
+   the bandwidth bench's buffers are written, the default timing is restored at the end */
+#define SDRAM_TUNE_STEPS   4U
+
+struct SdramTuneBench {
+  SdramTiming timing[SDRAM_TUNE_STEPS];
+  std::uint32_t passed[SDRAM_TUNE_STEPS];
+  std::uint32_t fail_addr[SDRAM_TUNE_STEPS];
+  std::uint32_t copy_cycles[SDRAM_TUNE_STEPS];
+};
+
+extern SdramTuneBench sdram_tune_bench;
+
+void bench_sdram_tune();
+#endif /* DATA_IN_ExtSDRAM */
+
+/* Clears .bss_deferred in one go and stores the time in boot_bench.deferred_zero,
+   which is the work taken off the reset to main path */
+void bench_deferred_zero();
+
+/* Runs every benchmark above, called from main */
+void bench_run_all();
+
+#endif /* HOMA_BENCH */
+
+#endif
@@ -0,0 +1,262 @@
+#include "clock.h"
+#include "memory_map.h"
+#include "system.h"
+#include "reset.h"
+
+/* Bus prescalers as CFGR bits, the dividers were checked in ClockTree */
+constexpr std::uint32_t clock_hpre(std::uint32_t div){
+  std::uint32_t bits = 0;
+  for(std::uint32_t d = div; d > 1; d >>= 1){
+    bits++;
+  }
+  /* 1 -> 0b0000, 2 -> 0b1000 ... 16 -> 0b1011, 64 -> 0b1100 (there is no 32) */
+  return (div == 1) ? 0 : ((bits < 5) ? (0x7 + bits) : (0x6 + bits));
+}
+
+constexpr std::uint32_t clock_ppre(std::uint32_t div){
+  std::uint32_t bits = 0;
+  for(std::uint32_t d = div; d > 1; d >>= 1){
+    bits++;
+  }
+  /* 1 -> 0b000, 2 -> 0b100 ... 16 -> 0b111 */
+  return (div == 1) ? 0 : (0x3 + bits);
+}
+
+static_assert(clock_hpre(1) == 0x0 && clock_hpre(2) == 0x8 && clock_hpre(16) == 0xB && clock_hpre(64) == 0xC &&
+              clock_hpre(512) == 0xF, "HPRE encoding");
+static_assert(clock_ppre(1) == 0x0 && clock_ppre(2) == 0x4 && clock_ppre(16) == 0x7, "PPRE encoding");
+
+/* Everything clock_set_speed writes for one operating point, worked out at compile time */
+struct ClockOpp {
+  std::uint32_t pllcfgr_hse;   /* 0: SYSCLK straight from the HSI, PLL off */
+  std::uint32_t pllcfgr_hsi;   /* same tree from the HSI when the HSE is dead */
+  std::uint32_t cfgr;          /* HPRE, PPRE1, PPRE2 */
+  std::uint32_t latency;       /* FLASH->ACR LATENCY field */
+  std::uint32_t vos;           /* PWR->CR VOS field */
+  bool overdrive;
+  ClockFreqs freqs;
+};
+
+template <typename Tree>
+constexpr std::uint32_t clock_pllcfgr(std::uint32_t source){
+  /* P is encoded as P/2 - 1 */
+  return (Tree::pll.m << RCC_PLLCFGR_PLLM_Pos) | (Tree::pll.n << RCC_PLLCFGR_PLLN_Pos) |
+         (((Tree::pll.p >> 1) - 1) << RCC_PLLCFGR_PLLP_Pos) | (Tree::pll.q << RCC_PLLCFGR_PLLQ_Pos) | source;
+}
+
+/* VOS is 0b11 for scale 1, 0b10 for scale 2 and 0b01 for scale 3 */
+constexpr std::uint32_t clock_vos(std::uint32_t scale){
+  return (4 - scale) << PWR_CR_VOS_Pos;
+}
+
+template <typename Tree>
+constexpr ClockOpp clock_opp(){
+  using TreeHsi = ClockTree<HSI_VALUE, Tree::sysclk, Tree::ahb_div, Tree::apb1_div, Tree::apb2_div>;
+
+  return {clock_pllcfgr<Tree>(RCC_PLLCFGR_PLLSRC_HSE), clock_pllcfgr<TreeHsi>(RCC_PLLCFGR_PLLSRC_HSI),
+          (clock_hpre(Tree::ahb_div) << RCC_CFGR_HPRE_Pos) | (clock_ppre(Tree::apb1_div) << RCC_CFGR_PPRE1_Pos) |
+          (clock_ppre(Tree::apb2_div) << RCC_CFGR_PPRE2_Pos),
+          Tree::flash_latency << FLASH_ACR_LATENCY_Pos, clock_vos(Tree::vos_scale), Tree::overdrive,
+          {Tree::hclk, Tree::pclk1, Tree::pclk2, Tree::apb1_timclk, Tree::apb2_timclk}};
+}
+
+static const ClockOpp clock_opps[CLOCK_SPEED_COUNT] = {
+  clock_opp<SysClock>(),
+  clock_opp<Clock168>(),
+  clock_opp<Clock84>(),
+  {0, 0, 0, 0, clock_vos(3), false, {HSI_VALUE, HSI_VALUE, HSI_VALUE, HSI_VALUE, HSI_VALUE}},
+};
+
+struct ClockListenerSlot {
+  ClockListener listener;
+  void *arg;
+};
+
+static ClockListenerSlot clock_listeners[CLOCK_MAX_LISTENERS];
+
+/* HSI out of reset */
+static ClockSpeed clock_current = CLOCK_SPEED_16MHZ;
+static bool clock_current_valid = false;
+
+static void clock_notify(ClockEvent event, const ClockFreqs &freqs){
+  for(std::uint32_t i = 0; i < CLOCK_MAX_LISTENERS; i++){
+    if(nullptr != clock_listeners[i].listener){
+      clock_listeners[i].listener(event, freqs, clock_listeners[i].arg);
+    }
+  }
+}
+
+static void clock_set_latency(std::uint32_t latency){
+  MODIFY_REG(FLASH->ACR, FLASH_ACR_LATENCY, latency);
+  while((FLASH->ACR & FLASH_ACR_LATENCY) != latency);
+}
+
+/* The PLL runs from the HSE if this leaves HSERDY set, from the HSI otherwise */
+static void clock_hse_start(){
+  /* A previous boot already found the HSE dead, don't wait for it again */
+  if(warm_valid(WARM_HSE_FAILED)){
+    return;
+  }
+
+  RCC->CR |= RCC_CR_HSEON;
+  for(std::uint32_t timeout = HSE_STARTUP_TIMEOUT; timeout > 0; timeout--){
+    if(RCC->CR & RCC_CR_HSERDY){
+      return;
+    }
+  }
+
+  RCC->CR &= ~RCC_CR_HSEON;
+  warm_set(WARM_HSE_FAILED);
+}
+
+/* Move from whatever runs now to opp, see clock.h for the order */
+static void clock_switch(const ClockOpp &opp){
+  /* More wait states are always safe, fewer only once the clock is down */
+  if(opp.latency > (FLASH->ACR & FLASH_ACR_LATENCY)){
+    clock_set_latency(opp.latency);
+  }
+
+  MODIFY_REG(RCC->CFGR, RCC_CFGR_SW, RCC_CFGR_SW_HSI);
+  while((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_HSI);
+
+  /* Over-drive can only be left (and entered) with SYSCLK on HSI or HSE */
+  if(!opp.overdrive && (PWR->CR & PWR_CR_ODEN)){
+    PWR->CR &= ~PWR_CR_ODSWEN;
+    while(PWR->CSR & PWR_CSR_ODSWRDY);
+    PWR->CR &= ~PWR_CR_ODEN;
+  }
+
+  RCC->CR &= ~RCC_CR_PLLON;
+  while(RCC->CR & RCC_CR_PLLRDY);
+
+  /* VOS is latched while the PLL is off and takes effect when it starts */
+  MODIFY_REG(PWR->CR, PWR_CR_VOS, opp.vos);
+  MODIFY_REG(RCC->CFGR, RCC_CFGR_HPRE | RCC_CFGR_PPRE1 | RCC_CFGR_PPRE2, opp.cfgr);
+
+  if(0 != opp.pllcfgr_hse){
+    RCC->PLLCFGR = (RCC->CR & RCC_CR_HSERDY) ? opp.pllcfgr_hse : opp.pllcfgr_hsi;
+    RCC->CR |= RCC_CR_PLLON;
+
+    /* Over-drive is enabled with the PLL on and before switching to it (RM0090 5.1.4),
+       the switch to over-drive mode waits for the regulator to get there */
+    if(opp.overdrive && !(PWR->CSR & PWR_CSR_ODSWRDY)){
+      PWR->CR |= PWR_CR_ODEN;
+      while(!(PWR->CSR & PWR_CSR_ODRDY));
+      PWR->CR |= PWR_CR_ODSWEN;
+      while(!(PWR->CSR & PWR_CSR_ODSWRDY));
+    }
+
+    while(!(RCC->CR & RCC_CR_PLLRDY));
+
+    MODIFY_REG(RCC->CFGR, RCC_CFGR_SW, RCC_CFGR_SW_PLL);
+    while((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL);
+  }
+
+  if(opp.latency < (FLASH->ACR & FLASH_ACR_LATENCY)){
+    clock_set_latency(opp.latency);
+  }
+
+  SystemCoreClock = opp.freqs.hclk;
+}
+
+void SystemClock_Config(void){
+  /* The PWR clock has to be on to touch PWR->CR */
+  RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+  (void)RCC->APB1ENR;
+
+  clock_hse_start();
+
+  /* The ART caches are flushed while still disabled, then enabled together with prefetch */
+  FLASH->ACR = FLASH_ACR_ICRST | FLASH_ACR_DCRST;
+  FLASH->ACR = 0;
+  FLASH->ACR = FLASH_ACR_PRFTEN | FLASH_ACR_ICEN | FLASH_ACR_DCEN;
+
+  clock_set_speed(CLOCK_SPEED_180MHZ);
+}
+
+void clock_set_speed(ClockSpeed speed){
+  if(clock_current_valid && (speed == clock_current)){
+    return;
+  }
+
+  const ClockOpp &opp = clock_opps[speed];
+  clock_notify(CLOCK_PRE_CHANGE, opp.freqs);
+
+  std::uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  clock_switch(opp);
+  clock_current = speed;
+  clock_current_valid = true;
+  __set_PRIMASK(primask);
+
+  clock_notify(CLOCK_POST_CHANGE, opp.freqs);
+}
+
+ClockSpeed clock_speed(void){
+  return clock_current;
+}
+
+const ClockFreqs &clock_freqs(void){
+  return clock_opps[clock_current].freqs;
+}
+
+bool clock_listener_add(ClockListener listener, void *arg){
+  for(std::uint32_t i = 0; i < CLOCK_MAX_LISTENERS; i++){
+    if(nullptr == clock_listeners[i].listener){
+      clock_listeners[i].listener = listener;
+      clock_listeners[i].arg = arg;
+      return true;
+    }
+  }
+  return false;
+}
+
+void clock_listener_remove(ClockListener listener, void *arg){
+  for(std::uint32_t i = 0; i < CLOCK_MAX_LISTENERS; i++){
+    if((listener == clock_listeners[i].listener) && (arg == clock_listeners[i].arg)){
+      clock_listeners[i].listener = nullptr;
+      clock_listeners[i].arg = nullptr;
+    }
+  }
+}
+
+std::uint32_t clock_deadline_us(std::uint32_t us){
+  return DWT_GetCycleCount() + us * (SystemCoreClock / 1000000U);
+}
+
+bool clock_expired(std::uint32_t deadline){
+  /* Wrap safe as long as the deadline is less than 2^31 cycles away */
+  return (std::int32_t)(DWT_GetCycleCount() - deadline) >= 0;
+}
+
+void clock_delay_us(std::uint32_t us){
+  std::uint32_t deadline = clock_deadline_us(us);
+  while(!clock_expired(deadline));
+}
+
+std::uint32_t SystemClock_GetHCLKFreq(void){
+  SystemCoreClockUpdate();
+  return SystemCoreClock;
+}
+
+std::uint32_t SystemClock_GetPCLK1Freq(void){
+  return SystemClock_GetHCLKFreq() >> APBPrescTable[(RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos];
+}
+
+std::uint32_t SystemClock_GetPCLK2Freq(void){
+  return SystemClock_GetHCLKFreq() >> APBPrescTable[(RCC->CFGR & RCC_CFGR_PPRE2) >> RCC_CFGR_PPRE2_Pos];
+}
+
+void SystemClock_Report(void){
+  const char *source = "HSI";
+  if((RCC->CFGR & RCC_CFGR_SWS) == RCC_CFGR_SWS_PLL){
+    source = (RCC->PLLCFGR & RCC_PLLCFGR_PLLSRC_HSE) ? "PLL (HSE)" : "PLL (HSI)";
+  }
+
+  printf("clock: SYSCLK from %s\n", source);
+  printf("clock: AHB  %lu Hz\n", (unsigned long)SystemClock_GetHCLKFreq());
+  printf("clock: APB1 %lu Hz\n", (unsigned long)SystemClock_GetPCLK1Freq());
+  printf("clock: APB2 %lu Hz\n", (unsigned long)SystemClock_GetPCLK2Freq());
+  printf("clock: flash %lu wait states%s\n", (unsigned long)(FLASH->ACR & FLASH_ACR_LATENCY),
+         (FLASH->ACR & FLASH_ACR_DCEN) ? ", ART on" : "");
+}
@@ -0,0 +1,107 @@
+#ifndef __CLOCK_H
+#define __CLOCK_H
+
+#include "homa_base.h"
+#include "clock_tree.h"
+
+/*
+Clock tree bring-up, called from SystemInit. The factors come from SysClock in
+clock_tree.h, solved at compile time:
+
+  HSE 8 MHz  /M 4   -> 2 MHz PLL input
+             *N 180 -> 360 MHz VCO
+             /P 2   -> SYSCLK 180 MHz
+             /Q 8   -> 45 MHz PLL48CLK (48 MHz for USB OTG FS needs a different VCO)
+
+  AHB  /1 -> HCLK  180 MHz  (core, DMA, FMC)
+  APB1 /4 -> PCLK1  45 MHz  (max 45, timers on APB1 run at 90 MHz)
+  APB2 /2 -> PCLK2  90 MHz  (max 90, timers on APB2 run at 180 MHz)
+
+180 MHz needs the regulator at voltage scale 1 with over-drive on, and 5 flash wait
+states with the ART accelerator (prefetch, instruction and data cache) enabled.
+
+If the HSE doesn't come up SysClockHsi runs the same tree from the 16 MHz HSI instead,
+and the failure is remembered as a warm flag so a warm reset doesn't wait for it again.
+*/
+
+/* Loop iterations to wait for HSERDY, at 16 MHz HSI this is a few ms */
+#define HSE_STARTUP_TIMEOUT   0x5000U
+
+extern std::uint32_t SystemCoreClock;
+extern const std::uint8_t AHBPrescTable[16];
+extern const std::uint8_t APBPrescTable[8];
+
+void SystemCoreClockUpdate(void);
+
+/* Bring SYSCLK up to 180 MHz from the PLL (CLOCK_SPEED_180MHZ), updates SystemCoreClock */
+void SystemClock_Config(void);
+
+/* Bus frequencies as currently configured in RCC, in Hz */
+std::uint32_t SystemClock_GetHCLKFreq(void);
+std::uint32_t SystemClock_GetPCLK1Freq(void);
+std::uint32_t SystemClock_GetPCLK2Freq(void);
+
+/* Print the clock source and the AHB/APB1/APB2 frequencies over stdout */
+void SystemClock_Report(void);
+
+/* Busy wait on the DWT cycle counter (started by Reset_Handler), scaled by SystemCoreClock
+   so it's right at any operating point. At least us microseconds, up to ~11 s at 180 MHz */
+void clock_delay_us(std::uint32_t us);
+
+/* DWT cycle count us microseconds from now, for polling with a timeout:
+     std::uint32_t deadline = clock_deadline_us(100);
+     while(busy()){ if(clock_expired(deadline)) return false; } */
+std::uint32_t clock_deadline_us(std::uint32_t us);
+bool clock_expired(std::uint32_t deadline);
+
+/*
+Runtime frequency scaling between fixed operating points, no reset needed.
+
+A switch always goes through the 16 MHz HSI: SYSCLK moves to HSI, the PLL is stopped
+and reprogrammed together with the regulator scale (VOS only takes effect with the PLL
+off), over-drive is turned on or off, then SYSCLK moves back to the PLL. Flash wait
+states go up before the clock does and down only after it has. Interrupts are masked
+for the switch itself, which takes in the order of 100 us (PLL lock).
+
+Drivers that derive a divisor from a bus clock (USART BRR, SPI baud, timer PSC) register
+a listener. It's called with CLOCK_PRE_CHANGE before the switch (drain a FIFO, stop a
+transfer) and CLOCK_POST_CHANGE after it with the new frequencies.
+*/
+
+enum ClockSpeed {
+  CLOCK_SPEED_180MHZ,   /* HSE PLL, scale 1 + over-drive, 5 WS (boot default) */
+  CLOCK_SPEED_168MHZ,   /* HSE PLL, scale 1, 5 WS, 48 MHz PLL48CLK */
+  CLOCK_SPEED_84MHZ,    /* HSE PLL, scale 3, 2 WS */
+  CLOCK_SPEED_16MHZ,    /* HSI, PLL off, scale 3, 0 WS */
+  CLOCK_SPEED_COUNT
+};
+
+enum ClockEvent {
+  CLOCK_PRE_CHANGE,
+  CLOCK_POST_CHANGE
+};
+
+struct ClockFreqs {
+  std::uint32_t hclk;
+  std::uint32_t pclk1;
+  std::uint32_t pclk2;
+  std::uint32_t apb1_timclk;   /* TIM2-7, 12-14 */
+  std::uint32_t apb2_timclk;   /* TIM1, 8-11 */
+};
+
+typedef void (*ClockListener)(ClockEvent event, const ClockFreqs &freqs, void *arg);
+
+#define CLOCK_MAX_LISTENERS   8U
+
+/* Switch to speed and notify the listeners, does nothing if already there */
+void clock_set_speed(ClockSpeed speed);
+ClockSpeed clock_speed(void);
+
+/* Bus frequencies of the current operating point */
+const ClockFreqs &clock_freqs(void);
+
+/* False if all CLOCK_MAX_LISTENERS slots are taken */
+bool clock_listener_add(ClockListener listener, void *arg);
+void clock_listener_remove(ClockListener listener, void *arg);
+
+#endif
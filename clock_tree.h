@@ -0,0 +1,178 @@
+#ifndef __CLOCK_TREE_H
+#define __CLOCK_TREE_H
+
+#include "homa_base.h"
+
+/*
+Compile time clock tree. A ClockTree names the PLL source and the frequencies wanted,
+the PLL factors are solved at compile time and every limit from the datasheet is checked
+with static_assert, so an impossible setup fails the build instead of the board.
+
+  using SysClock = ClockTree<HSE_VALUE, 180000000, 1, 4, 2>;
+
+  SysClock::pll.m / .n / .p / .q      PLLCFGR factors
+  SysClock::hclk, pclk1, pclk2        bus clocks in Hz
+  SysClock::apb1_timclk, apb2_timclk  timer kernel clocks on APB1 (TIM2-7, 12-14) / APB2 (TIM1, 8-11)
+  SysClock::flash_latency             wait states for hclk
+  SysClock::vos_scale, overdrive      regulator setting hclk needs
+
+Drivers take their clock from here, so divisors fold into constants:
+
+  USART1->BRR = usart_brr(SysClock::pclk2, 115200);
+  TIM2->PSC   = timer_prescaler(SysClock::apb1_timclk, 1000000) - 1;
+*/
+
+/* STM32F429 limits, scale 1 with over-drive, 2.7-3.6 V (DS9405 table 16, 18 and 19) */
+#define CLOCK_PLL_IN_MIN      1000000U
+#define CLOCK_PLL_IN_MAX      2000000U
+#define CLOCK_VCO_MIN         100000000U
+#define CLOCK_VCO_MAX         432000000U
+#define CLOCK_PLLN_MIN        50U
+#define CLOCK_PLLN_MAX        432U
+#define CLOCK_PLLM_MIN        2U
+#define CLOCK_PLLM_MAX        63U
+#define CLOCK_PLLQ_MIN        2U
+#define CLOCK_PLLQ_MAX        15U
+#define CLOCK_PLL48_MAX       48000000U
+#define CLOCK_SYSCLK_MAX      180000000U
+#define CLOCK_PCLK1_MAX       45000000U
+#define CLOCK_PCLK2_MAX       90000000U
+#define CLOCK_FLASH_WS_STEP   30000000U   /* one wait state per 30 MHz of HCLK */
+#define CLOCK_SCALE3_MAX      120000000U  /* highest HCLK per regulator scale, over-drive off */
+#define CLOCK_SCALE2_MAX      144000000U
+#define CLOCK_SCALE1_MAX      168000000U
+
+struct PllConfig {
+  std::uint32_t m;
+  std::uint32_t n;
+  std::uint32_t p;
+  std::uint32_t q;
+
+  constexpr bool valid() const { return m != 0; }
+};
+
+/* Largest PLL48CLK not above 48 MHz, 0 if Q can't get there */
+constexpr std::uint32_t pll_solve_q(std::uint32_t vco){
+  for(std::uint32_t q = CLOCK_PLLQ_MIN; q <= CLOCK_PLLQ_MAX; q++){
+    if(vco / q <= CLOCK_PLL48_MAX){
+      return q;
+    }
+  }
+  return 0;
+}
+
+/* First M/N/P that hits sysclk exactly, preferring the highest PLL input (lowest jitter)
+   and a setup where PLL48CLK is exactly 48 MHz. m == 0 if there is none */
+constexpr PllConfig pll_solve(std::uint32_t source, std::uint32_t sysclk){
+  PllConfig first = {0, 0, 0, 0};
+
+  for(std::uint32_t m = CLOCK_PLLM_MIN; m <= CLOCK_PLLM_MAX; m++){
+    std::uint32_t in = source / m;
+    if((source % m != 0) || (in > CLOCK_PLL_IN_MAX) || (in < CLOCK_PLL_IN_MIN)){
+      continue;
+    }
+
+    for(std::uint32_t p = 2; p <= 8; p += 2){
+      std::uint64_t vco = (std::uint64_t)sysclk * p;
+      if((vco % in != 0) || (vco < CLOCK_VCO_MIN) || (vco > CLOCK_VCO_MAX)){
+        continue;
+      }
+
+      std::uint32_t n = (std::uint32_t)(vco / in);
+      std::uint32_t q = pll_solve_q((std::uint32_t)vco);
+      if((n < CLOCK_PLLN_MIN) || (n > CLOCK_PLLN_MAX) || (0 == q)){
+        continue;
+      }
+
+      PllConfig config = {m, n, p, q};
+      if(vco % CLOCK_PLL48_MAX == 0){
+        return config;
+      }
+      if(!first.valid()){
+        first = config;
+      }
+    }
+  }
+
+  return first;
+}
+
+/* Lowest regulator scale (1 is the highest voltage) that runs hclk, over-drive is needed on top
+   of scale 1 above 168 MHz */
+constexpr std::uint32_t clock_vos_scale(std::uint32_t hclk){
+  return (hclk > CLOCK_SCALE2_MAX) ? 1 : ((hclk > CLOCK_SCALE3_MAX) ? 2 : 3);
+}
+
+constexpr bool clock_needs_overdrive(std::uint32_t hclk){
+  return hclk > CLOCK_SCALE1_MAX;
+}
+
+/* APB timers run at twice PCLK unless the APB prescaler is 1 */
+constexpr std::uint32_t clock_timer_freq(std::uint32_t hclk, std::uint32_t apb_div){
+  return (1 == apb_div) ? hclk : (2 * hclk / apb_div);
+}
+
+constexpr bool clock_valid_ahb_div(std::uint32_t div){
+  return (1 == div) || (2 == div) || (4 == div) || (8 == div) || (16 == div) ||
+         (64 == div) || (128 == div) || (256 == div) || (512 == div);
+}
+
+constexpr bool clock_valid_apb_div(std::uint32_t div){
+  return (1 == div) || (2 == div) || (4 == div) || (8 == div) || (16 == div);
+}
+
+template <std::uint32_t Source, std::uint32_t Sysclk, std::uint32_t AhbDiv, std::uint32_t Apb1Div, std::uint32_t Apb2Div>
+struct ClockTree {
+  static constexpr std::uint32_t source = Source;
+  static constexpr std::uint32_t sysclk = Sysclk;
+  static constexpr PllConfig pll = pll_solve(Source, Sysclk);
+
+  static constexpr std::uint32_t vco = pll.valid() ? (Source / pll.m * pll.n) : 0;
+  static constexpr std::uint32_t pll48 = pll.valid() ? (vco / pll.q) : 0;
+
+  static constexpr std::uint32_t ahb_div = AhbDiv;
+  static constexpr std::uint32_t apb1_div = Apb1Div;
+  static constexpr std::uint32_t apb2_div = Apb2Div;
+
+  static constexpr std::uint32_t hclk = Sysclk / AhbDiv;
+  static constexpr std::uint32_t pclk1 = hclk / Apb1Div;
+  static constexpr std::uint32_t pclk2 = hclk / Apb2Div;
+  static constexpr std::uint32_t apb1_timclk = clock_timer_freq(hclk, Apb1Div);
+  static constexpr std::uint32_t apb2_timclk = clock_timer_freq(hclk, Apb2Div);
+
+  static constexpr std::uint32_t flash_latency = (hclk - 1) / CLOCK_FLASH_WS_STEP;
+  static constexpr std::uint32_t vos_scale = clock_vos_scale(hclk);
+  static constexpr bool overdrive = clock_needs_overdrive(hclk);
+
+  static_assert(pll.valid(), "no PLL M/N/P/Q reaches this SYSCLK from this source");
+  static_assert(!pll.valid() || ((Source / pll.m >= CLOCK_PLL_IN_MIN) && (Source / pll.m <= CLOCK_PLL_IN_MAX)), "PLL input out of range");
+  static_assert(!pll.valid() || ((vco >= CLOCK_VCO_MIN) && (vco <= CLOCK_VCO_MAX)), "VCO out of range");
+  static_assert(!pll.valid() || (vco / pll.p == Sysclk), "PLL doesn't hit SYSCLK exactly");
+  static_assert(pll48 <= CLOCK_PLL48_MAX, "PLL48CLK above 48 MHz");
+  static_assert(Sysclk <= CLOCK_SYSCLK_MAX, "SYSCLK above 180 MHz");
+  static_assert(clock_valid_ahb_div(AhbDiv), "AHB prescaler must be 1, 2, 4 ... 512 (no 32)");
+  static_assert(clock_valid_apb_div(Apb1Div) && clock_valid_apb_div(Apb2Div), "APB prescaler must be 1, 2, 4, 8 or 16");
+  static_assert(pclk1 <= CLOCK_PCLK1_MAX, "PCLK1 above 45 MHz");
+  static_assert(pclk2 <= CLOCK_PCLK2_MAX, "PCLK2 above 90 MHz");
+};
+
+/* The clock tree SystemClock_Config sets up, and its fallback when the HSE doesn't start */
+using SysClock = ClockTree<HSE_VALUE, 180000000U, 1, 4, 2>;
+using SysClockHsi = ClockTree<HSI_VALUE, SysClock::sysclk, SysClock::ahb_div, SysClock::apb1_div, SysClock::apb2_div>;
+
+/* The other PLL operating points of clock_set_speed (clock.h). The lowest one runs from
+   the HSI with the PLL off and has no tree */
+using Clock168 = ClockTree<HSE_VALUE, 168000000U, 1, 4, 2>;
+using Clock84 = ClockTree<HSE_VALUE, 84000000U, 1, 2, 1>;
+
+/* USART BRR for 16x oversampling, mantissa and 4 bit fraction together are pclk / baud rounded */
+constexpr std::uint32_t usart_brr(std::uint32_t pclk, std::uint32_t baud){
+  return (pclk + baud / 2) / baud;
+}
+
+/* Timer prescaler (PSC + 1) that gives a tick_hz counter clock, tick_hz must divide timclk */
+constexpr std::uint32_t timer_prescaler(std::uint32_t timclk, std::uint32_t tick_hz){
+  return timclk / tick_hz;
+}
+
+#endif
@@ -0,0 +1,246 @@
+#include "console.h"
+#include "memory_map.h"
+#include "clock.h"
+#include "clock_tree.h"
+#include <cstring>
+
+#define CONSOLE_MASK        (CONSOLE_TX_BYTES - 1U)
+#define CONSOLE_BASEPRI     (CONSOLE_PRIORITY << (8U - __NVIC_PRIO_BITS))
+#define CONSOLE_TX_PIN      9U          /* PA9 */
+#define CONSOLE_AF_USART1   7U
+#define CONSOLE_DMA_CHANNEL 4U          /* USART1_TX on DMA2 stream 7 */
+#define CONSOLE_DMA_FLAGS   (DMA_HIFCR_CTCIF7 | DMA_HIFCR_CHTIF7 | DMA_HIFCR_CTEIF7 | DMA_HIFCR_CDMEIF7 | DMA_HIFCR_CFEIF7)
+
+static_assert(0 == (CONSOLE_TX_BYTES & CONSOLE_MASK), "CONSOLE_TX_BYTES has to be a power of 2");
+
+/* Free running indices, [tail, queued) is with the DMA, [queued, head) waits for it */
+static std::uint8_t console_buf[CONSOLE_TX_BYTES];
+static std::uint32_t console_tail;
+static std::uint32_t console_queued;
+static std::uint32_t console_head;
+
+static bool console_ready;
+static bool console_paused;     /* clock switch in progress */
+static ConsoleOverflow console_overflow = CONSOLE_OVERFLOW_DEFAULT;
+static ConsoleStats stats;
+
+static std::uint32_t console_lock(){
+  std::uint32_t prev = __get_BASEPRI();
+  __set_BASEPRI_MAX(CONSOLE_BASEPRI);
+  return prev;
+}
+
+static void console_unlock(std::uint32_t prev){
+  __set_BASEPRI(prev);
+}
+
+/* Lock held from here on */
+
+static std::uint32_t console_space(){
+  return CONSOLE_TX_BYTES - (console_head - console_tail);
+}
+
+/* Hand the queued bytes up to the end of the ring to the DMA, if it's idle */
+static void console_kick(){
+  if(!console_ready || console_paused || (console_queued != console_tail) || (console_head == console_queued)){
+    return;
+  }
+  std::uint32_t at = console_queued & CONSOLE_MASK;
+  std::uint32_t len = console_head - console_queued;
+  if(len > CONSOLE_TX_BYTES - at){
+    len = CONSOLE_TX_BYTES - at;
+  }
+
+  DMA2->HIFCR = CONSOLE_DMA_FLAGS;
+  DMA2_Stream7->M0AR = (std::uint32_t)&console_buf[at];
+  DMA2_Stream7->NDTR = len;
+  DMA2_Stream7->CR |= DMA_SxCR_EN;
+  console_queued += len;
+}
+
+/* Retire a finished transfer and start the next, from the interrupt or a writer waiting */
+static void console_service(){
+  std::uint32_t flags = DMA2->HISR & (DMA_HISR_TCIF7 | DMA_HISR_TEIF7);
+  if(0 == flags){
+    return;
+  }
+  DMA2->HIFCR = CONSOLE_DMA_FLAGS;
+  if(flags & DMA_HISR_TEIF7){
+    stats.errors++;
+  }
+  stats.sent += console_queued - console_tail;
+  console_tail = console_queued;
+  console_kick();
+}
+
+/* Throw away the oldest bytes bytes still queued, the newer ones move down over them */
+static void console_discard(std::uint32_t bytes){
+  for(std::uint32_t from = console_queued + bytes; from != console_head; from++){
+    console_buf[(from - bytes) & CONSOLE_MASK] = console_buf[from & CONSOLE_MASK];
+  }
+  console_head -= bytes;
+  stats.overwritten += bytes;
+}
+
+static void console_copy(const std::uint8_t *data, std::uint32_t len){
+  std::uint32_t at = console_head & CONSOLE_MASK;
+  std::uint32_t first = (len < CONSOLE_TX_BYTES - at) ? len : CONSOLE_TX_BYTES - at;
+  std::memcpy(&console_buf[at], data, first);
+  std::memcpy(console_buf, data + first, len - first);
+  console_head += len;
+}
+
+void DMA2_Stream7_Handler(void){
+  std::uint32_t prev = console_lock();
+  console_service();
+  console_unlock(prev);
+}
+
+/* Lock not held from here on */
+
+static void console_clock_changed(ClockEvent event, const ClockFreqs &freqs, void *){
+  if(CLOCK_PRE_CHANGE == event){
+    console_flush();
+    console_paused = true;
+    return;
+  }
+
+  std::uint32_t prev = console_lock();
+  USART1->BRR = usart_brr(freqs.pclk2, CONSOLE_BAUD);
+  console_paused = false;
+  console_kick();
+  console_unlock(prev);
+}
+
+void console_init(void){
+  RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN | RCC_AHB1ENR_DMA2EN;
+  RCC->APB2ENR |= RCC_APB2ENR_USART1EN;
+  (void)RCC->APB2ENR;
+
+  /* Alternate function 7, high speed, push-pull, no pull */
+  GPIOA->AFR[CONSOLE_TX_PIN >> 3] = (GPIOA->AFR[CONSOLE_TX_PIN >> 3] & ~(0xFU << ((CONSOLE_TX_PIN & 7) * 4))) |
+                                    (CONSOLE_AF_USART1 << ((CONSOLE_TX_PIN & 7) * 4));
+  GPIOA->MODER = (GPIOA->MODER & ~(3U << (CONSOLE_TX_PIN * 2))) | (2U << (CONSOLE_TX_PIN * 2));
+  GPIOA->OSPEEDR = (GPIOA->OSPEEDR & ~(3U << (CONSOLE_TX_PIN * 2))) | (2U << (CONSOLE_TX_PIN * 2));
+  GPIOA->OTYPER &= ~(1U << CONSOLE_TX_PIN);
+  GPIOA->PUPDR &= ~(3U << (CONSOLE_TX_PIN * 2));
+
+  /* 8N1, DMA requests on TXE */
+  USART1->BRR = usart_brr(clock_freqs().pclk2, CONSOLE_BAUD);
+  USART1->CR3 = USART_CR3_DMAT;
+  USART1->CR1 = USART_CR1_UE | USART_CR1_TE;
+
+  /* Memory to peripheral, bytes, memory increment, direct mode (FIFO off) */
+  DMA2_Stream7->CR = 0;
+  while(DMA2_Stream7->CR & DMA_SxCR_EN);
+  DMA2_Stream7->PAR = (std::uint32_t)&USART1->DR;
+  DMA2_Stream7->FCR = 0;
+  DMA2_Stream7->CR = (CONSOLE_DMA_CHANNEL << DMA_SxCR_CHSEL_Pos) | DMA_SxCR_DIR_0 | DMA_SxCR_MINC |
+                     DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+
+  NVIC_SetPriority(DMA2_Stream7_IRQn, CONSOLE_PRIORITY);
+  NVIC_EnableIRQ(DMA2_Stream7_IRQn);
+  clock_listener_add(console_clock_changed, nullptr);
+
+  std::uint32_t prev = console_lock();
+  console_ready = true;
+  console_kick();
+  console_unlock(prev);
+}
+
+std::size_t console_write(const void *data, std::size_t len){
+  const std::uint8_t *p = (const std::uint8_t *)data;
+  std::size_t left = len;
+  bool waited = false;
+
+  std::uint32_t prev = console_lock();
+  stats.written += len;
+  while(0 != left){
+    std::uint32_t space = console_space();
+
+    if((left > space) && (CONSOLE_OVERFLOW_OVERWRITE == console_overflow)){
+      std::uint32_t queued = console_head - console_queued;
+      std::uint32_t discard = (left - space < queued) ? left - space : queued;
+      console_discard(discard);
+      space += discard;
+      if(left > space){
+        /* The DMA still has the rest, keep the newest */
+        stats.dropped += left - space;
+        p += left - space;
+        left = space;
+      }
+    }
+
+    std::uint32_t n = (left < space) ? left : space;
+    console_copy(p, n);
+    console_kick();
+    p += n;
+    left -= n;
+
+    if(0 == left){
+      break;
+    }
+    if((CONSOLE_OVERFLOW_BLOCK != console_overflow) || !console_ready || console_paused){
+      stats.dropped += left;
+      break;
+    }
+
+    /* Let interrupts in while waiting, the DMA one does the work unless it's masked */
+    waited = true;
+    console_unlock(prev);
+    prev = console_lock();
+    console_service();
+  }
+  if(waited){
+    stats.waits++;
+  }
+  console_unlock(prev);
+  return len;
+}
+
+void console_flush(void){
+  if(!console_ready){
+    return;
+  }
+  for(;;){
+    std::uint32_t prev = console_lock();
+    console_service();
+    bool empty = console_head == console_tail;
+    console_unlock(prev);
+    if(empty || console_paused){
+      break;
+    }
+  }
+  while(!(USART1->SR & USART_SR_TC));
+}
+
+void console_write_polled(const void *data, std::size_t len){
+  const std::uint8_t *p = (const std::uint8_t *)data;
+  std::uint32_t prev = console_lock();
+  bool was_paused = console_paused;
+  console_paused = true;
+
+  /* Let the transfer in flight finish, the rest of the ring stays queued */
+  while(console_ready && (console_queued != console_tail)){
+    console_service();
+  }
+  for(std::size_t i = 0; i < len; i++){
+    while(!(USART1->SR & USART_SR_TXE));
+    USART1->DR = p[i];
+  }
+  while(!(USART1->SR & USART_SR_TC));
+
+  console_paused = was_paused;
+  console_kick();
+  console_unlock(prev);
+}
+
+ConsoleOverflow console_set_overflow(ConsoleOverflow policy){
+  ConsoleOverflow old = console_overflow;
+  console_overflow = policy;
+  return old;
+}
+
+const ConsoleStats &console_stats(void){
+  return stats;
+}
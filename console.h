@@ -0,0 +1,70 @@
+#ifndef __CONSOLE_H
+#define __CONSOLE_H
+
+#include "homa_base.h"
+
+/*
+UART console, USART1 on PA9 (TX only), the ST-LINK's virtual COM port on the Discovery board.
+
+_write (syscalls.cpp, so printf and friends) copies into a CONSOLE_TX_BYTES ring and
+returns, DMA2 stream 7 (channel 4, USART1_TX) sends it in the background. Each transfer
+covers the bytes queued up to the end of the ring; its completion interrupt queues the next
+one. The caller only pays for the copy and for starting the stream if it was idle.
+
+When a write doesn't fit, the overflow policy decides:
+
+  CONSOLE_OVERFLOW_DROP       keep what fits, drop the rest of the write, never waits
+  CONSOLE_OVERFLOW_BLOCK      wait for the DMA to make room, nothing is lost (default)
+  CONSOLE_OVERFLOW_OVERWRITE  drop the oldest output not yet handed to the DMA to make room,
+                              the newest output is kept. Moving the queued bytes down costs up
+                              to CONSOLE_TX_BYTES byte copies, only when it happens
+
+A blocked writer polls the stream's completion flag itself, so BLOCK also works with
+interrupts masked or from an interrupt. The ring is guarded by a BASEPRI section at
+CONSOLE_PRIORITY, the DMA interrupt's priority, so writers have to run at that priority or
+below (numerically at least CONSOLE_PRIORITY). Anything before console_init is kept in the
+ring and goes out once it runs; BLOCK drops instead of waiting for it.
+
+A clock_set_speed switch drains the ring first and sets BRR for the new PCLK2 after it.
+console_write_polled goes around the ring for when interrupts and DMA can't be trusted.
+*/
+
+#define CONSOLE_BAUD          115200U
+#define CONSOLE_TX_BYTES      1024U     /* power of 2 */
+#define CONSOLE_PRIORITY      6U        /* NVIC priority of the DMA interrupt, 0 (most urgent) to 15 */
+
+enum ConsoleOverflow {
+  CONSOLE_OVERFLOW_DROP,
+  CONSOLE_OVERFLOW_BLOCK,
+  CONSOLE_OVERFLOW_OVERWRITE
+};
+
+#ifndef CONSOLE_OVERFLOW_DEFAULT
+#define CONSOLE_OVERFLOW_DEFAULT   CONSOLE_OVERFLOW_BLOCK
+#endif
+
+struct ConsoleStats {
+  std::uint32_t written;      /* bytes given to console_write */
+  std::uint32_t sent;         /* bytes the DMA finished */
+  std::uint32_t dropped;      /* lost to DROP, or to OVERWRITE when the DMA had the rest */
+  std::uint32_t overwritten;  /* queued bytes OVERWRITE threw away */
+  std::uint32_t waits;        /* writes BLOCK had to wait for */
+  std::uint32_t errors;       /* DMA transfer errors */
+};
+
+/* Pins, USART1 and the DMA stream, starts sending whatever was written before */
+void console_init(void);
+
+/* Queue len bytes, returns len whatever the policy did with them (see ConsoleStats) */
+std::size_t console_write(const void *data, std::size_t len);
+
+/* Wait until everything queued is on the wire */
+void console_flush(void);
+
+/* Wait for the DMA, then send len bytes straight to the USART */
+void console_write_polled(const void *data, std::size_t len);
+
+ConsoleOverflow console_set_overflow(ConsoleOverflow policy);
+const ConsoleStats &console_stats(void);
+
+#endif
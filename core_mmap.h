@@ -1315,6 +1315,9 @@ struct CoreDebug_Type
   @{
  */
 
+#define NVIC_USER_IRQ_OFFSET          16                                /*!< Vector table index of IRQ 0, the first 16 entries are system exceptions */
+
+
 /**
   \brief   Set Priority Grouping
   \details Sets the priority grouping field using the required unlock sequence.
@@ -1533,6 +1536,34 @@ static inline void NVIC_SystemReset(void)
   }
 }
 
+/**
+  \brief   Set Interrupt Vector
+  \details Sets an interrupt vector in the vector table VTOR currently points at.
+           Only has an effect when the table lives in RAM (VECT_TAB_SRAM), writes to
+           the flash table are ignored.
+  \param [in]   IRQn      Interrupt number
+  \param [in]   vector    Address of interrupt handler function
+ */
+static inline void NVIC_SetVector(IRQn_Type IRQn, uint32_t vector)
+{
+  uint32_t *vectors = (uint32_t *)SCB->VTOR;
+  vectors[(int32_t)IRQn + NVIC_USER_IRQ_OFFSET] = vector;
+  __DSB();                                                          /* make sure the write lands before the IRQ can fire */
+}
+
+
+/**
+  \brief   Get Interrupt Vector
+  \details Reads an interrupt vector from the active vector table.
+  \param [in]   IRQn      Interrupt number.
+  \return                 Address of interrupt handler function
+ */
+static inline uint32_t NVIC_GetVector(IRQn_Type IRQn)
+{
+  uint32_t *vectors = (uint32_t *)SCB->VTOR;
+  return vectors[(int32_t)IRQn + NVIC_USER_IRQ_OFFSET];
+}
+
 /*@} end of Core_NVICFunctions */
 
 
@@ -1658,6 +1689,42 @@ static inline int32_t ITM_CheckChar (void)
 
 
 
+/* ##################################### DWT Cycle Counter function ########################################### */
+/**
+  \ingroup  Core_FunctionInterface
+  \defgroup Core_DWTFunctions DWT Cycle Counter Functions
+  \brief    Functions that access the DWT cycle counter, used for timing and benchmarks.
+  @{
+ */
+
+/**
+  \brief   Enable Cycle Counter
+  \details Enables the trace blocks (DEMCR.TRCENA), clears DWT->CYCCNT and starts it.
+           The counter runs at HCLK and wraps every 2^32 cycles, so unsigned
+           subtraction of two readings is always valid for intervals below that.
+ */
+static inline void DWT_EnableCycleCounter(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;                   /* enable DWT and ITM */
+  DWT->CYCCNT = 0UL;                                                /* reset the counter */
+  DWT->CTRL  |= DWT_CTRL_CYCCNTENA_Msk;                             /* start counting */
+}
+
+
+/**
+  \brief   Get Cycle Count
+  \details Reads the current value of the DWT cycle counter.
+  \return  Number of core clock cycles since \ref DWT_EnableCycleCounter.
+ */
+static inline uint32_t DWT_GetCycleCount(void)
+{
+  return (DWT->CYCCNT);
+}
+
+/*@} end of Core_DWTFunctions */
+
+
+
 
 #ifdef __cplusplus
 }
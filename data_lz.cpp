@@ -0,0 +1,9 @@
+/*
+Pulls the packed .data/.ccmram load images made by rle_pack into the .data_lz section.
+Only built for final_lz.elf, see the Makefile. Going through the compiler instead of
+objcopy -I binary keeps the object's ABI attributes in line with the rest of the image.
+*/
+
+asm(".section .data_lz, \"a\"  \n"
+    ".incbin \"data_lz.bin\"    \n"
+    ".previous                 \n");
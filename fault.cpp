@@ -0,0 +1,188 @@
+#include "fault.h"
+#include "memory_map.h"
+#include "sections.h"
+#include "startup.h"
+
+HOMA_NOINIT static CrashRecord crash_record;
+
+/* RAM the frame may be in, reading it anywhere else could fault again inside the handler */
+struct FaultRam {
+  std::uint32_t start;
+  std::uint32_t end;
+};
+
+static const FaultRam fault_ram[] = {
+  {0x20000000U, 0x20030000U},   /* SRAM1, SRAM2, SRAM3 */
+  {0x10000000U, 0x10010000U},   /* CCM */
+};
+
+/* fault_capture's own stack, the handlers load its top by name */
+extern "C" {
+[[gnu::used, gnu::aligned(8)]] std::uint32_t fault_stack[64];
+}
+static_assert(sizeof(fault_stack) == 256, "the handlers' ldr of the stack top assumes 256 bytes");
+
+#define CFSR_MSTKERR     (1U << 4)
+#define CFSR_MMARVALID   (1U << 7)
+#define CFSR_STKERR      (1U << 12)
+#define CFSR_BFARVALID   (1U << 15)
+
+static const struct {
+  std::uint32_t bit;
+  const char *name;
+} cfsr_bits[] = {
+  {1U << 0, "IACCVIOL"}, {1U << 1, "DACCVIOL"}, {1U << 3, "MUNSTKERR"}, {CFSR_MSTKERR, "MSTKERR"},
+  {1U << 5, "MLSPERR"}, {CFSR_MMARVALID, "MMARVALID"}, {1U << 8, "IBUSERR"}, {1U << 9, "PRECISERR"},
+  {1U << 10, "IMPRECISERR"}, {1U << 11, "UNSTKERR"}, {CFSR_STKERR, "STKERR"}, {1U << 13, "LSPERR"},
+  {CFSR_BFARVALID, "BFARVALID"}, {1U << 16, "UNDEFINSTR"}, {1U << 17, "INVSTATE"}, {1U << 18, "INVPC"},
+  {1U << 19, "NOCP"}, {1U << 24, "UNALIGNED"}, {1U << 25, "DIVBYZERO"},
+};
+
+static std::uint32_t crash_record_sum(){
+  const std::uint32_t *word = (const std::uint32_t *)&crash_record;
+  std::uint32_t sum = 0;
+  for(std::uint32_t i = 0; i < offsetof(CrashRecord, checksum) / sizeof(std::uint32_t); i++){
+    sum = ((sum << 1) | (sum >> 31)) ^ word[i];
+  }
+  return sum;
+}
+
+static bool crash_record_valid(){
+  return (CRASH_RECORD_MAGIC == crash_record.magic) && (crash_record_sum() == crash_record.checksum);
+}
+
+static bool fault_frame_readable(std::uint32_t sp){
+  for(const FaultRam &ram : fault_ram){
+    if((sp >= ram.start) && (sp + sizeof(FaultFrame) <= ram.end) && (0 == (sp & 3U))){
+      return true;
+    }
+  }
+  return false;
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Called from the naked handlers with the frame's stack pointer and EXC_RETURN. Runs on
+   the MSP, whatever state the faulting code left, so it only touches the record */
+[[noreturn, gnu::used]] void fault_capture(std::uint32_t sp, std::uint32_t exc_return){
+  std::uint32_t count = crash_record_valid() ? crash_record.count : 0;
+  std::uint32_t cfsr = SCB->CFSR;
+
+  crash_record.magic = CRASH_RECORD_MAGIC;
+  crash_record.count = count + 1;
+  crash_record.type = __get_IPSR() & 0x1FFU;
+  crash_record.exc_return = exc_return;
+  crash_record.sp = sp;
+  crash_record.cfsr = cfsr;
+  crash_record.hfsr = SCB->HFSR;
+  crash_record.mmfar = SCB->MMFAR;
+  crash_record.bfar = SCB->BFAR;
+  crash_record.boot_count = boot_record.boot_count;
+  crash_record.reported = 0;
+
+  /* A failed push leaves nothing (or half a frame) at sp */
+  crash_record.frame_valid = fault_frame_readable(sp) && !(cfsr & (CFSR_MSTKERR | CFSR_STKERR));
+  if(crash_record.frame_valid){
+    crash_record.frame = *(const FaultFrame *)sp;
+  }
+  else{
+    boot_zero(&crash_record.frame, sizeof(crash_record.frame));
+  }
+
+  crash_record.checksum = crash_record_sum();
+  NVIC_SystemReset();
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+/* Bit 2 of EXC_RETURN tells which stack the frame went to. fault_capture gets a stack of
+   its own, the MSP may be what overflowed */
+#define FAULT_HANDLER(name)                         \
+  [[gnu::naked]] void name(void){                   \
+    asm volatile(                                   \
+      "tst lr, #4            \n"                    \
+      "ite eq                \n"                    \
+      "mrseq r0, msp         \n"                    \
+      "mrsne r0, psp         \n"                    \
+      "mov r1, lr            \n"                    \
+      "ldr r2, =fault_stack + 256 \n"               \
+      "msr msp, r2           \n"                    \
+      "b fault_capture       \n"                    \
+      ".ltorg                \n");                  \
+  }
+
+FAULT_HANDLER(HardFault_Handler)
+FAULT_HANDLER(MemManage_Handler)
+FAULT_HANDLER(BusFault_Handler)
+FAULT_HANDLER(UsageFault_Handler)
+
+void fault_init(void){
+  SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA_Msk | SCB_SHCSR_BUSFAULTENA_Msk | SCB_SHCSR_USGFAULTENA_Msk;
+  SCB->CCR |= SCB_CCR_DIV_0_TRP_Msk;
+
+  /* Status bits are sticky across a system reset, clear the last crash's */
+  SCB->CFSR = SCB->CFSR;
+  SCB->HFSR = SCB->HFSR;
+}
+
+const CrashRecord *fault_last(void){
+  return crash_record_valid() ? &crash_record : nullptr;
+}
+
+void fault_report(void){
+  static const char *const names[] = {"", "", "", "HardFault", "MemManage", "BusFault", "UsageFault"};
+
+  if(!crash_record_valid() || crash_record.reported){
+    return;
+  }
+
+  const CrashRecord &c = crash_record;
+  const char *name = (c.type < sizeof(names) / sizeof(names[0])) ? names[c.type] : "";
+
+  printf("crash #%lu: %s (exception %lu) in boot #%lu\n", (unsigned long)c.count, name, (unsigned long)c.type,
+         (unsigned long)c.boot_count);
+  printf("  exc_return 0x%08lx, %s 0x%08lx\n", (unsigned long)c.exc_return, (c.exc_return & 4U) ? "psp" : "msp",
+         (unsigned long)c.sp);
+
+  if(c.frame_valid){
+    printf("  pc 0x%08lx lr 0x%08lx xpsr 0x%08lx\n", (unsigned long)c.frame.pc, (unsigned long)c.frame.lr,
+           (unsigned long)c.frame.xpsr);
+    printf("  r0 0x%08lx r1 0x%08lx r2 0x%08lx r3 0x%08lx r12 0x%08lx\n", (unsigned long)c.frame.r0,
+           (unsigned long)c.frame.r1, (unsigned long)c.frame.r2, (unsigned long)c.frame.r3, (unsigned long)c.frame.r12);
+  }
+  else{
+    printf("  no frame, stacking failed or sp outside RAM\n");
+  }
+
+  printf("  cfsr 0x%08lx hfsr 0x%08lx", (unsigned long)c.cfsr, (unsigned long)c.hfsr);
+  for(const auto &b : cfsr_bits){
+    if(c.cfsr & b.bit){
+      printf(" %s", b.name);
+    }
+  }
+  if(c.hfsr & SCB_HFSR_FORCED_Msk){
+    printf(" FORCED");
+  }
+  if(c.hfsr & SCB_HFSR_VECTTBL_Msk){
+    printf(" VECTTBL");
+  }
+  printf("\n");
+
+  if(c.cfsr & CFSR_MSTKERR){
+    /* The MPU only maps stack guards (mpu.h), a frame that didn't fit went past one */
+    printf("  stack overflow, exception entry hit a stack guard\n");
+  }
+  if(c.cfsr & CFSR_MMARVALID){
+    printf("  mmfar 0x%08lx\n", (unsigned long)c.mmfar);
+  }
+  if(c.cfsr & CFSR_BFARVALID){
+    printf("  bfar 0x%08lx\n", (unsigned long)c.bfar);
+  }
+
+  crash_record.reported = 1;
+  crash_record.checksum = crash_record_sum();
+}
@@ -0,0 +1,66 @@
+#ifndef __FAULT_H
+#define __FAULT_H
+
+#include "homa_base.h"
+
+/*
+Crash capture for HardFault, MemManage, BusFault and UsageFault.
+
+fault.cpp defines the four fault handlers, overriding the weak Default_Handler aliases in
+startup.cpp. Each one picks the stack the exception frame was pushed to (MSP or PSP,
+from EXC_RETURN), copies the frame and the fault status registers into a crash record in
+.noinit and resets the chip straight away. The record survives the reset and is printed
+by fault_report on the next boot.
+
+Reset_Handler calls fault_init first thing so faults during init are caught as well.
+*/
+
+#define CRASH_RECORD_MAGIC   0xC4A54ED0U
+
+enum FaultType {
+  FAULT_HARD = 3,         /* exception numbers */
+  FAULT_MEMMANAGE = 4,
+  FAULT_BUS = 5,
+  FAULT_USAGE = 6
+};
+
+/* What the core pushed on exception entry */
+struct FaultFrame {
+  std::uint32_t r0;
+  std::uint32_t r1;
+  std::uint32_t r2;
+  std::uint32_t r3;
+  std::uint32_t r12;
+  std::uint32_t lr;
+  std::uint32_t pc;       /* faulting instruction (or the next one, imprecise bus faults) */
+  std::uint32_t xpsr;
+};
+
+struct CrashRecord {
+  std::uint32_t magic;
+  std::uint32_t count;        /* crashes since power on */
+  std::uint32_t type;         /* FaultType */
+  std::uint32_t exc_return;
+  std::uint32_t sp;           /* where the frame is, MSP or PSP */
+  std::uint32_t frame_valid;  /* 0 if the frame couldn't be read (stacking failed, sp out of RAM) */
+  FaultFrame frame;
+  std::uint32_t cfsr;
+  std::uint32_t hfsr;
+  std::uint32_t mmfar;
+  std::uint32_t bfar;
+  std::uint32_t boot_count;   /* boot_record.boot_count of the boot that crashed */
+  std::uint32_t reported;     /* fault_report already printed it */
+  std::uint32_t checksum;
+};
+
+/* Enable the MemManage, BusFault and UsageFault exceptions (they escalate to HardFault
+   otherwise) and division by zero trapping */
+void fault_init(void);
+
+/* The last crash, nullptr if there is none or it's garbage (power on) */
+const CrashRecord *fault_last(void);
+
+/* Print the last crash over stdout once, later boots stay quiet until the next crash */
+void fault_report(void);
+
+#endif
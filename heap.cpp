@@ -0,0 +1,310 @@
+#include "heap.h"
+
+/* No heap at all in a HOMA_NO_HEAP build, see new_delete.h */
+#if !defined (HOMA_NO_HEAP)
+
+#include "memory_map.h"
+#include "syslock.h"
+#include <string.h>
+
+struct Heap {
+  Tlsf tlsf;                /* all zero (.bss) is an empty Tlsf */
+  std::uint8_t *start;      /* first pool, nullptr until the first grow */
+  std::uint8_t *end;        /* end of the last pool */
+  std::size_t size;         /* bytes taken from the region */
+  std::uint32_t failed;
+};
+
+static Heap heaps[MEM_REGION_COUNT];
+
+#if defined (HOMA_HEAP_TRACE)
+HeapTrace heap_trace;
+#endif /* HOMA_HEAP_TRACE */
+
+/* Called with the malloc lock held */
+static void heap_trace_add(HeapOp op, const void *ptr, const void *old, std::size_t size, void *caller){
+#if defined (HOMA_HEAP_TRACE)
+  HeapTraceEntry &e = heap_trace.entries[heap_trace.next & (HEAP_TRACE_DEPTH - 1)];
+  e.ptr = ptr;
+  e.old = old;
+  e.caller = caller;
+  e.size = (std::uint32_t)size;
+  e.op = op;
+  e.stamp = DWT_GetCycleCount();
+  heap_trace.next++;
+#else
+  (void)op;
+  (void)ptr;
+  (void)old;
+  (void)size;
+  (void)caller;
+#endif /* HOMA_HEAP_TRACE */
+}
+
+/* Heap whose pools hold ptr. Regions don't overlap, and memory between two pools of a heap
+   (region_alloc'd in between) is never passed in */
+static Heap *heap_of(const void *ptr){
+  for(Heap &h : heaps){
+    if(((const std::uint8_t *)ptr >= h.start) && ((const std::uint8_t *)ptr < h.end)){
+      return &h;
+    }
+  }
+  return nullptr;
+}
+
+/* Make room for a size byte block. The TLSF search rounds a request up by at most 1/16th,
+   plus the block and pool headers */
+static bool heap_grow(MemRegion region, std::size_t size){
+  Heap &h = heaps[region];
+  std::size_t need = size + (size >> TLSF_SL_LOG2) + 4 * TLSF_HEADER;
+  std::size_t bytes = (need + HEAP_GROW_BYTES - 1) & ~(std::size_t)(HEAP_GROW_BYTES - 1);
+
+  if(bytes > region_free(region)){
+    /* Last grow, whatever is left */
+    bytes = region_free(region) & ~(std::size_t)(TLSF_ALIGN - 1);
+    if(bytes < need){
+      return false;
+    }
+  }
+
+  std::uint8_t *mem = (std::uint8_t *)region_sbrk(region, (std::ptrdiff_t)bytes);
+  if((void *)-1 == mem){
+    return false;
+  }
+
+  if((nullptr != h.end) && (mem == h.end)){
+    h.end = (std::uint8_t *)tlsf_extend_pool(&h.tlsf, h.end, bytes);
+    h.size += bytes;
+    return true;
+  }
+
+  std::uint8_t *end = (std::uint8_t *)tlsf_add_pool(&h.tlsf, mem, bytes);
+  if(nullptr == end){
+    return false;
+  }
+  if(nullptr == h.start){
+    h.start = mem;
+  }
+  h.end = end;
+  h.size += bytes;
+  return true;
+}
+
+static void *heap_take(struct _reent *reent, MemRegion region, std::size_t align, std::size_t size, void *caller){
+  if(region >= MEM_REGION_COUNT){
+    reent->_errno = ENOMEM;
+    return nullptr;
+  }
+
+  Heap &h = heaps[region];
+  __malloc_lock(reent);
+  void *ptr = tlsf_memalign(&h.tlsf, align, size);
+  if((nullptr == ptr) && heap_grow(region, size + align)){
+    ptr = tlsf_memalign(&h.tlsf, align, size);
+  }
+  if(nullptr == ptr){
+    h.failed++;
+  }
+  heap_trace_add((nullptr != ptr) ? HEAP_OP_ALLOC : HEAP_OP_FAILED, ptr, nullptr, size, caller);
+  __malloc_unlock(reent);
+
+  if(nullptr == ptr){
+    reent->_errno = ENOMEM;
+  }
+  return ptr;
+}
+
+static void *heap_resize(struct _reent *reent, void *ptr, std::size_t size, void *caller){
+  if(nullptr == ptr){
+    return heap_take(reent, HEAP_DEFAULT_REGION, TLSF_ALIGN, size, caller);
+  }
+  Heap *h = heap_of(ptr);
+  if(nullptr == h){
+    return nullptr;
+  }
+
+  __malloc_lock(reent);
+  void *moved = tlsf_realloc(&h->tlsf, ptr, size);
+  if((nullptr == moved) && (0 != size) && heap_grow((MemRegion)(h - heaps), size)){
+    moved = tlsf_realloc(&h->tlsf, ptr, size);
+  }
+  if((nullptr == moved) && (0 != size)){
+    h->failed++;
+    heap_trace_add(HEAP_OP_FAILED, ptr, nullptr, size, caller);
+  }
+  else{
+    heap_trace_add(HEAP_OP_REALLOC, moved, ptr, size, caller);
+  }
+  __malloc_unlock(reent);
+
+  if((nullptr == moved) && (0 != size)){
+    reent->_errno = ENOMEM;
+  }
+  return moved;
+}
+
+static void heap_release(struct _reent *reent, void *ptr, void *caller){
+  Heap *h = heap_of(ptr);
+  if(nullptr == h){
+    return;
+  }
+  __malloc_lock(reent);
+  heap_trace_add(HEAP_OP_FREE, ptr, nullptr, tlsf_block_size(ptr), caller);
+  tlsf_free(&h->tlsf, ptr);
+  __malloc_unlock(reent);
+}
+
+void *heap_alloc(MemRegion region, std::size_t size){
+  return heap_take(_REENT, region, TLSF_ALIGN, size, __builtin_return_address(0));
+}
+
+void *heap_memalign(MemRegion region, std::size_t align, std::size_t size){
+  return heap_take(_REENT, region, align, size, __builtin_return_address(0));
+}
+
+void *heap_realloc(void *ptr, std::size_t size){
+  return heap_resize(_REENT, ptr, size, __builtin_return_address(0));
+}
+
+void heap_free(void *ptr){
+  heap_release(_REENT, ptr, __builtin_return_address(0));
+}
+
+std::size_t heap_usable_size(const void *ptr){
+  return (nullptr != heap_of(ptr)) ? tlsf_block_size(ptr) : 0;
+}
+
+void heap_stats(MemRegion region, HeapStats *stats){
+  if(region >= MEM_REGION_COUNT){
+    *stats = {};
+    return;
+  }
+
+  TlsfStats t;
+  __malloc_lock(_REENT);
+  tlsf_stats(&heaps[region].tlsf, &t);
+  stats->size = heaps[region].size;
+  stats->failed = heaps[region].failed;
+  __malloc_unlock(_REENT);
+
+  stats->used = t.used;
+  stats->used_peak = t.used_peak;
+  stats->free = t.free;
+  stats->largest_free = t.largest_free;
+  stats->used_blocks = t.used_blocks;
+  stats->fragmentation = t.fragmentation;
+}
+
+void heap_report(void){
+  static const char *const names[MEM_REGION_COUNT] = {"sram", "ccm", "sdram"};
+
+  printf("heap    size     used     peak     free  largest  blocks  frag  failed\n");
+  for(std::uint32_t r = 0; r < MEM_REGION_COUNT; r++){
+    HeapStats s;
+    heap_stats((MemRegion)r, &s);
+    printf("%-5s %7lu  %7lu  %7lu  %7lu  %7lu  %6lu  %2lu.%lu%%  %6lu\n", names[r], (unsigned long)s.size,
+           (unsigned long)s.used, (unsigned long)s.used_peak, (unsigned long)s.free, (unsigned long)s.largest_free,
+           (unsigned long)s.used_blocks, (unsigned long)(s.fragmentation / 10), (unsigned long)(s.fragmentation % 10),
+           (unsigned long)s.failed);
+  }
+}
+
+#if defined (HOMA_HEAP_TRACE)
+void heap_trace_dump(void){
+  static const char *const ops[] = {"alloc", "free", "realloc", "FAILED"};
+
+  /* printf can allocate too, stop at the calls made before the dump */
+  std::uint32_t next = heap_trace.next;
+  std::uint32_t count = (next < HEAP_TRACE_DEPTH) ? next : HEAP_TRACE_DEPTH;
+  printf("last %lu of %lu heap calls\n", (unsigned long)count, (unsigned long)next);
+  for(std::uint32_t i = next - count; i != next; i++){
+    const HeapTraceEntry &e = heap_trace.entries[i & (HEAP_TRACE_DEPTH - 1)];
+    printf("  %10lu  %-7s %08lx  %6lu bytes  from %08lx", (unsigned long)e.stamp, ops[e.op], (unsigned long)e.ptr,
+           (unsigned long)e.size, (unsigned long)e.caller);
+    if(HEAP_OP_REALLOC == e.op){
+      printf("  was %08lx", (unsigned long)e.old);
+    }
+    printf("\n");
+  }
+}
+#endif /* HOMA_HEAP_TRACE */
+
+#if !defined (HOMA_MALLOC_NEWLIB)
+
+/* In place of newlib-nano's nano-mallocr. newlib itself (stdio buffers, strdup) calls the
+   _r versions */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void *_memalign_r(struct _reent *reent, std::size_t align, std::size_t size){
+  return heap_take(reent, HEAP_DEFAULT_REGION, align, size, __builtin_return_address(0));
+}
+
+void *_malloc_r(struct _reent *reent, std::size_t size){
+  return heap_take(reent, HEAP_DEFAULT_REGION, TLSF_ALIGN, size, __builtin_return_address(0));
+}
+
+static void *heap_calloc(struct _reent *reent, std::size_t count, std::size_t size, void *caller){
+  std::size_t bytes;
+  if(__builtin_mul_overflow(count, size, &bytes)){
+    reent->_errno = ENOMEM;
+    return nullptr;
+  }
+
+  void *ptr = heap_take(reent, HEAP_DEFAULT_REGION, TLSF_ALIGN, bytes, caller);
+  if(nullptr != ptr){
+    memset(ptr, 0, bytes);
+  }
+  return ptr;
+}
+
+void *_calloc_r(struct _reent *reent, std::size_t count, std::size_t size){
+  return heap_calloc(reent, count, size, __builtin_return_address(0));
+}
+
+void *_realloc_r(struct _reent *reent, void *ptr, std::size_t size){
+  return heap_resize(reent, ptr, size, __builtin_return_address(0));
+}
+
+void _free_r(struct _reent *reent, void *ptr){
+  heap_release(reent, ptr, __builtin_return_address(0));
+}
+
+std::size_t _malloc_usable_size_r(struct _reent *reent, void *ptr){
+  (void)reent;
+  return heap_usable_size(ptr);
+}
+
+void *malloc(std::size_t size){
+  return heap_take(_REENT, HEAP_DEFAULT_REGION, TLSF_ALIGN, size, __builtin_return_address(0));
+}
+
+void *calloc(std::size_t count, std::size_t size){
+  return heap_calloc(_REENT, count, size, __builtin_return_address(0));
+}
+
+void *realloc(void *ptr, std::size_t size){
+  return heap_resize(_REENT, ptr, size, __builtin_return_address(0));
+}
+
+void *memalign(std::size_t align, std::size_t size){
+  return heap_take(_REENT, HEAP_DEFAULT_REGION, align, size, __builtin_return_address(0));
+}
+
+void free(void *ptr){
+  heap_release(_REENT, ptr, __builtin_return_address(0));
+}
+
+std::size_t malloc_usable_size(void *ptr){
+  return heap_usable_size(ptr);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !HOMA_MALLOC_NEWLIB */
+
+#endif /* !HOMA_NO_HEAP */
@@ -0,0 +1,96 @@
+#ifndef __HEAP_H
+#define __HEAP_H
+
+#include "homa_base.h"
+#include "sysmem.h"
+#include "tlsf.h"
+
+/*
+System heap, a TLSF heap (tlsf.h) per memory region of sysmem.h. A heap starts empty and
+grows through region_sbrk when nothing fits, at least HEAP_GROW_BYTES at a time, so it
+shares the break with region_alloc. A grow that lands right after the heap's last pool
+extends that pool.
+
+malloc, free, realloc, calloc, memalign and newlib's _malloc_r family are defined here and
+take the place of newlib-nano's first fit malloc, allocating from HEAP_DEFAULT_REGION.
+make MALLOC=newlib builds without them (HOMA_MALLOC_NEWLIB) to compare against, the
+heap_ functions are there in both builds.
+
+Every call takes __malloc_lock, like newlib's malloc does. free and realloc find the heap
+from the address, so any pointer from any region can go to them.
+
+Every heap keeps its used, peak and free byte counts as it goes (a few adds per call, always
+on). heap_stats adds the largest free block and the fragmentation. make HEAP_TRACE=1
+(HOMA_HEAP_TRACE) also logs the last HEAP_TRACE_DEPTH calls with their caller's address
+into heap_trace, a ring that can be read with a debugger or printed by heap_trace_dump.
+Dumps taken before the ring wraps can be replayed against the other allocators on the host
+or under QEMU, see alloc_replay.cpp.
+
+  float *samples = (float *)heap_alloc(MEM_REGION_CCM, 1024 * sizeof(float));
+  ...
+  free(samples);
+*/
+
+#define HEAP_GROW_BYTES       4096U
+#define HEAP_DEFAULT_REGION   MEM_REGION_SRAM
+
+void *heap_alloc(MemRegion region, std::size_t size);
+
+/* align is a power of 2 */
+void *heap_memalign(MemRegion region, std::size_t align, std::size_t size);
+
+/* Stays in the region ptr came from */
+void *heap_realloc(void *ptr, std::size_t size);
+
+void heap_free(void *ptr);
+
+/* Usable bytes behind ptr, 0 if it's not from a heap */
+std::size_t heap_usable_size(const void *ptr);
+
+/* Byte counts are block payloads, size includes the block headers */
+struct HeapStats {
+  std::size_t size;               /* taken from the region so far */
+  std::size_t used;
+  std::size_t used_peak;
+  std::size_t free;               /* in the heap, the region may have more */
+  std::size_t largest_free;
+  std::uint32_t used_blocks;
+  std::uint32_t fragmentation;    /* per mille of free not in the largest free block */
+  std::uint32_t failed;           /* allocations that returned nullptr */
+};
+
+void heap_stats(MemRegion region, HeapStats *stats);
+
+/* heap_stats of every region over stdout */
+void heap_report(void);
+
+enum HeapOp {
+  HEAP_OP_ALLOC,
+  HEAP_OP_FREE,
+  HEAP_OP_REALLOC,
+  HEAP_OP_FAILED
+};
+
+#if defined (HOMA_HEAP_TRACE)
+#define HEAP_TRACE_DEPTH   64U    /* power of 2 */
+
+struct HeapTraceEntry {
+  const void *ptr;        /* block allocated, freed or moved to, the old one for a failed realloc */
+  const void *old;        /* the block a realloc moved from, nullptr for the other calls */
+  void *caller;           /* return address of the malloc/free/... call */
+  std::uint32_t size;     /* asked for, or the block size for a free */
+  std::uint32_t op;       /* HeapOp */
+  std::uint32_t stamp;    /* DWT cycle counter */
+};
+
+struct HeapTrace {
+  HeapTraceEntry entries[HEAP_TRACE_DEPTH];
+  std::uint32_t next;     /* total calls traced, entries[next % HEAP_TRACE_DEPTH] is the oldest */
+};
+
+extern HeapTrace heap_trace;
+
+void heap_trace_dump(void);
+#endif /* HOMA_HEAP_TRACE */
+
+#endif
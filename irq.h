@@ -0,0 +1,97 @@
+#ifndef __IRQ_H
+#define __IRQ_H
+
+#include "homa_base.h"
+#include "memory_map.h"
+
+/*
+Binding interrupts to C++ driver objects.
+
+The handler for an IRQ is a plain function whose address sits in the vector table. The
+templates below generate that function at compile time for a member function or lambda,
+so binding costs at most the load of the object pointer, the member call itself is a
+direct (usually tail) call or inlined. bench_irq_latency measures it against a plain
+handler.
+
+Flash vector table (any build). The named handler from startup.cpp is defined to forward
+to a member of a global object, overriding the weak alias:
+
+  Uart uart1;
+  HOMA_IRQ_FORWARD(USART1_Handler, uart1, &Uart::isr)
+
+RAM vector table (make VECTORS=sram). Handlers are swapped in at runtime with
+NVIC_SetVector:
+
+  irq_bind<TIM2_IRQn, &Timer::isr, tim2>();     // global object, known at compile time
+  irq_bind<TIM3_IRQn, &Timer::isr>(timers[i]);  // object picked at runtime, one extra load
+  irq_bind<EXTI0_IRQn>([]{ button_pressed = true; });   // captureless lambda or function
+  irq_unbind(TIM3_IRQn);
+
+Only captureless lambdas can be bound, state goes in the object of a member binding.
+*/
+
+#define IRQ_COUNT   (DMA2D_IRQn + 1)
+
+#define HOMA_IRQ_FORWARD(handler, object, member)   \
+  void handler(void){ ((object).*(member))(); }
+
+template <typename M>
+struct IrqMemberClass;
+
+template <typename C>
+struct IrqMemberClass<void (C::*)()> {
+  using type = C;
+};
+
+/* Object of every irq_bind<N, Member>(object) binding, indexed by IRQ number */
+inline void *irq_objects[IRQ_COUNT];
+
+template <IRQn_Type N, auto Member, auto &Object>
+void irq_static_trampoline(void){
+  (Object.*Member)();
+}
+
+template <IRQn_Type N, auto Member>
+void irq_object_trampoline(void){
+  using C = typename IrqMemberClass<decltype(Member)>::type;
+  (static_cast<C *>(irq_objects[N])->*Member)();
+}
+
+#ifdef VECT_TAB_SRAM
+
+template <IRQn_Type N, auto Member, auto &Object>
+void irq_bind(void){
+  static_assert((N >= 0) && (N < IRQ_COUNT), "not a peripheral IRQ");
+  NVIC_SetVector(N, (std::uint32_t)&irq_static_trampoline<N, Member, Object>);
+}
+
+template <IRQn_Type N, auto Member>
+void irq_bind(typename IrqMemberClass<decltype(Member)>::type &object){
+  static_assert((N >= 0) && (N < IRQ_COUNT), "not a peripheral IRQ");
+  /* The object has to be visible before the vector that reads it */
+  irq_objects[N] = &object;
+  NVIC_SetVector(N, (std::uint32_t)&irq_object_trampoline<N, Member>);
+}
+
+template <IRQn_Type N>
+void irq_bind(void (*handler)(void)){
+  static_assert((N >= 0) && (N < IRQ_COUNT), "not a peripheral IRQ");
+  NVIC_SetVector(N, (std::uint32_t)handler);
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void Default_Handler(void);
+#ifdef __cplusplus
+}
+#endif
+
+inline void irq_unbind(IRQn_Type irq){
+  NVIC_SetVector(irq, (std::uint32_t)&Default_Handler);
+  irq_objects[irq] = nullptr;
+}
+
+#endif /* VECT_TAB_SRAM */
+
+#endif
@@ -0,0 +1,158 @@
+#include "itm.h"
+#include <cstring>
+
+#if defined (__arm__)
+#include "memory_map.h"
+#include "clock.h"
+#endif
+
+#define ITM_PORTS   ((1U << ITM_PORT_LOG) | (1U << ITM_PORT_TRACE) | (1U << ITM_PORT_METRICS))
+
+static std::int8_t itm_fd_ports[ITM_FD_MAX] = {
+#if defined (HOMA_CONSOLE_ITM)
+  -1, ITM_PORT_LOG, ITM_PORT_LOG,
+#else
+  -1, -1, -1,
+#endif
+  ITM_PORT_LOG, ITM_PORT_TRACE, ITM_PORT_METRICS, -1, -1
+};
+
+static_assert(ITM_FD_MAX == sizeof(itm_fd_ports), "itm_fd_ports doesn't cover ITM_FD_MAX fds");
+
+#if defined (__arm__)
+
+/* ------------------------------------------------------------------------- */
+/* ITM and TPIU                                                               */
+/* ------------------------------------------------------------------------- */
+
+#define ITM_UNLOCK      0xC5ACCE55U   /* LAR key */
+#define ITM_BUS_ID      1U
+#define TPI_SPPR_NRZ    2U            /* asynchronous, UART like */
+#define TPI_FFCR_TRIGIN 0x100U        /* formatter off, SWO carries the bare ITM stream */
+
+static std::uint32_t itm_baud;
+
+static void itm_set_prescaler(std::uint32_t hclk){
+  TPI->ACPR = hclk / itm_baud - 1U;
+}
+
+static void itm_clock_changed(ClockEvent event, const ClockFreqs &freqs, void *){
+  if(CLOCK_PRE_CHANGE == event){
+    while(ITM->TCR & ITM_TCR_BUSY_Msk);
+    return;
+  }
+  itm_set_prescaler(freqs.hclk);
+}
+
+void itm_init(std::uint32_t swo_baud){
+  itm_baud = swo_baud;
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DBGMCU->CR |= DBGMCU_CR_TRACE_IOEN;     /* TRACE_MODE 0, asynchronous on PB3 */
+
+  TPI->SPPR = TPI_SPPR_NRZ;
+  itm_set_prescaler(clock_freqs().hclk);
+  TPI->FFCR = TPI_FFCR_TRIGIN;
+
+  ITM->LAR = ITM_UNLOCK;
+  ITM->TCR = (ITM_BUS_ID << ITM_TCR_TraceBusID_Pos) | ITM_TCR_SYNCENA_Msk | ITM_TCR_ITMENA_Msk;
+  ITM->TPR = 0;                           /* unprivileged code may write every port */
+  ITM->TER = ITM_PORTS;
+
+  clock_listener_add(itm_clock_changed, nullptr);
+}
+
+bool itm_enabled(std::uint32_t port){
+  return (ITM->TCR & ITM_TCR_ITMENA_Msk) && (ITM->TER & (1U << port));
+}
+
+/* A port reads 1 while its FIFO has room */
+static void itm_put(std::uint32_t port, std::uint32_t value, std::uint32_t bytes){
+  auto &stim = ITM->PORT[port];
+  while(0 == stim.u32);
+  if(4 == bytes){
+    stim.u32 = value;
+  }
+  else if(2 == bytes){
+    stim.u16 = (std::uint16_t)value;
+  }
+  else{
+    stim.u8 = (std::uint8_t)value;
+  }
+}
+
+#else
+
+/* ------------------------------------------------------------------------- */
+/* Host stub                                                                  */
+/* ------------------------------------------------------------------------- */
+
+static FILE *itm_capture;
+
+void itm_host_capture(FILE *out){
+  itm_capture = out;
+}
+
+void itm_init(std::uint32_t swo_baud){
+  (void)swo_baud;
+}
+
+bool itm_enabled(std::uint32_t port){
+  return (nullptr != itm_capture) && (ITM_PORTS & (1U << port));
+}
+
+/* Instrumentation packet: port in bits 7:3, size (1, 2 or 4 bytes as 1, 2, 3) in 1:0, then
+   the payload, least significant byte first */
+static void itm_put(std::uint32_t port, std::uint32_t value, std::uint32_t bytes){
+  std::uint8_t packet[5] = {(std::uint8_t)((port << 3) | ((4 == bytes) ? 3U : bytes))};
+  for(std::uint32_t i = 0; i < bytes; i++){
+    packet[1 + i] = (std::uint8_t)(value >> (8 * i));
+  }
+  fwrite(packet, 1, 1 + bytes, itm_capture);
+}
+
+#endif /* __arm__ */
+
+std::size_t itm_write(std::uint32_t port, const void *data, std::size_t len){
+  if(!itm_enabled(port)){
+    return len;
+  }
+
+  const std::uint8_t *p = (const std::uint8_t *)data;
+  std::size_t left = len;
+  for(; left >= 4; left -= 4, p += 4){
+    std::uint32_t word;
+    std::memcpy(&word, p, 4);
+    itm_put(port, word, 4);
+  }
+  if(left >= 2){
+    std::uint16_t half;
+    std::memcpy(&half, p, 2);
+    itm_put(port, half, 2);
+    left -= 2;
+    p += 2;
+  }
+  if(0 != left){
+    itm_put(port, *p, 1);
+  }
+  return len;
+}
+
+void itm_send_word(std::uint32_t port, std::uint32_t word){
+  if(itm_enabled(port)){
+    itm_put(port, word, 4);
+  }
+}
+
+int itm_fd_port(int fd){
+  return ((fd >= 0) && (fd < ITM_FD_MAX)) ? itm_fd_ports[fd] : -1;
+}
+
+int itm_map_fd(int fd, int port){
+  if((fd < 0) || (fd >= ITM_FD_MAX)){
+    return -1;
+  }
+  int old = itm_fd_ports[fd];
+  itm_fd_ports[fd] = (std::int8_t)port;
+  return old;
+}
@@ -0,0 +1,72 @@
+#ifndef __ITM_H
+#define __ITM_H
+
+#include "homa_base.h"
+#include <stdio.h>
+
+/*
+ITM output over SWO (PB3), no UART needed, a debug probe reads it.
+
+Each stimulus port is its own stream: logs on ITM_PORT_LOG, trace events on
+ITM_PORT_TRACE, metrics on ITM_PORT_METRICS. The ITM packs whatever is written to a port into
+packets of 1, 2 or 4 bytes plus a header byte. itm_write sends whole words and only the tail
+goes out as a halfword or a byte, a quarter of the packets ITM_SendChar needs and 5 bytes on
+the wire for every 8. A port that's off, or an ITM that isn't enabled, costs a register
+read per call.
+
+_write (syscalls.cpp) sends file descriptors mapped with itm_map_fd to their port, and
+everything else to the UART console (console.h). ITM_FD_LOG, ITM_FD_TRACE and ITM_FD_METRICS
+come mapped. make CONSOLE=itm (HOMA_CONSOLE_ITM) maps stdout and stderr to ITM_PORT_LOG too:
+
+  dprintf(ITM_FD_TRACE, "rx %u\n", len);          // stdio, through _write
+  itm_send_word(ITM_PORT_METRICS, cycles);          // one word, no formatting
+
+Ports aren't locked. The port checks it has room and then writes, so an interrupt writing
+the same port in between can drop a packet, and messages from two contexts on one port
+mix at word boundaries. Keep a port per context where that matters.
+
+itm_init programs the TPIU for asynchronous NRZ at swo_baud from HCLK, which a probe
+might also do. A clock_set_speed switch waits for the ITM to drain, then sets the prescaler
+for the new HCLK. make swo captures SWO with OpenOCD, and itm_decode (itm_decode.cpp) splits
+the capture into ports.
+
+Host stub. On anything that isn't __arm__ this file compiles to a stand-in that encodes
+the same packets the ITM would and writes them to the FILE given to itm_host_capture, every
+port on. Code that logs through here runs on the host, and itm_decode reads its output like
+a capture from the board. make itm-test (itm_test.cpp) writes several ports through the stub
+and checks what itm_decode gets back.
+*/
+
+#define ITM_PORT_LOG       0U
+#define ITM_PORT_TRACE     1U
+#define ITM_PORT_METRICS   2U
+
+#define ITM_FD_LOG         3
+#define ITM_FD_TRACE       4
+#define ITM_FD_METRICS     5
+#define ITM_FD_MAX         8          /* file descriptors 0 to ITM_FD_MAX - 1 can be mapped */
+
+#define ITM_SWO_BAUD       2000000U   /* what an ST-LINK/V2 reads */
+
+void itm_init(std::uint32_t swo_baud);
+
+bool itm_enabled(std::uint32_t port);
+
+/* Send len bytes on port, a word at a time. Returns len, sent or not */
+std::size_t itm_write(std::uint32_t port, const void *data, std::size_t len);
+
+/* One 4 byte packet */
+void itm_send_word(std::uint32_t port, std::uint32_t word);
+
+/* Port of fd, -1 if it isn't mapped */
+int itm_fd_port(int fd);
+
+/* Send fd to port, -1 unmaps it. Returns the previous port, -1 for an fd out of range */
+int itm_map_fd(int fd, int port);
+
+#if !defined (__arm__)
+/* Where the host stub writes its packets, nullptr (the default) drops them */
+void itm_host_capture(FILE *out);
+#endif
+
+#endif
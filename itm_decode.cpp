@@ -0,0 +1,107 @@
+/*
+Host tool, splits an ITM stream (SWO captured with the TPIU formatter off, see make swo, or
+the host stub's output, see itm.h) into its stimulus ports.
+
+usage: itm_decode <capture.bin> [prefix]
+
+Port 0 (ITM_PORT_LOG) goes to stdout as is, every other port that shows up to
+<prefix><port>.bin (prefix defaults to itm_port). Packets, first byte:
+
+  00000000             sync, zeros up to a final 0x80
+  01110000             overflow, the ITM dropped something
+  AAAAA0SS             instrumentation, port A, SS 1/2/3 for 1/2/4 payload bytes
+  AAAAA1SS             hardware source (DWT), same size code, skipped
+  Cxxxxx00 the rest    timestamps and extensions, C set means another byte follows,
+                       skipped
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#define ITM_PORT_COUNT   32U
+
+static bool read_file(const char *path, std::vector<std::uint8_t> &out){
+  FILE *f = std::fopen(path, "rb");
+  if(nullptr == f){
+    return false;
+  }
+
+  std::uint8_t buf[4096];
+  std::size_t n;
+  while((n = std::fread(buf, 1, sizeof(buf), f)) > 0){
+    out.insert(out.end(), buf, buf + n);
+  }
+
+  std::fclose(f);
+  return true;
+}
+
+int main(int argc, char **argv){
+  if(argc < 2){
+    std::fprintf(stderr, "usage: itm_decode <capture.bin> [prefix]\n");
+    return 1;
+  }
+  const char *prefix = (argc > 2) ? argv[2] : "itm_port";
+
+  std::vector<std::uint8_t> in;
+  if(!read_file(argv[1], in)){
+    std::fprintf(stderr, "itm_decode: can't read %s\n", argv[1]);
+    return 1;
+  }
+
+  std::vector<std::uint8_t> ports[ITM_PORT_COUNT];
+  std::size_t overflows = 0, hardware = 0, truncated = 0;
+  std::size_t pos = 0;
+
+  while(pos < in.size()){
+    std::uint8_t h = in[pos++];
+
+    if(0 != (h & 3U)){
+      std::size_t size = (3U == (h & 3U)) ? 4U : (h & 3U);
+      if(pos + size > in.size()){
+        truncated++;
+        break;
+      }
+      if(0 == (h & 4U)){
+        ports[h >> 3].insert(ports[h >> 3].end(), in.begin() + pos, in.begin() + pos + size);
+      }
+      else{
+        hardware++;
+      }
+      pos += size;
+    }
+    else if(0x70U == h){
+      overflows++;
+    }
+    else if((0x00U != h) && (0x80U != h) && (h & 0x80U)){
+      while((pos < in.size()) && (in[pos++] & 0x80U));
+    }
+  }
+
+  std::fwrite(ports[0].data(), 1, ports[0].size(), stdout);
+  std::fflush(stdout);
+
+  for(std::uint32_t port = 1; port < ITM_PORT_COUNT; port++){
+    if(ports[port].empty()){
+      continue;
+    }
+    char path[256];
+    std::snprintf(path, sizeof(path), "%s%lu.bin", prefix, (unsigned long)port);
+    FILE *f = std::fopen(path, "wb");
+    if(nullptr == f){
+      std::fprintf(stderr, "itm_decode: can't write %s\n", path);
+      return 1;
+    }
+    std::fwrite(ports[port].data(), 1, ports[port].size(), f);
+    std::fclose(f);
+    std::fprintf(stderr, "itm_decode: port %lu, %zu bytes -> %s\n", (unsigned long)port, ports[port].size(), path);
+  }
+
+  if((0 != overflows) || (0 != hardware) || (0 != truncated)){
+    std::fprintf(stderr, "itm_decode: %zu overflows, %zu hardware packets skipped%s\n", overflows, hardware,
+                 (0 != truncated) ? ", capture ends in a packet" : "");
+  }
+  return 0;
+}
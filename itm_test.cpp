@@ -0,0 +1,109 @@
+/*
+Host test for the ITM output, see make itm-test. Built with itm.cpp's host stub, writes a
+capture through itm_write and itm_send_word the way code on the board would, and next to it
+what each port should carry once itm_decode has split the capture.
+
+usage: itm_test <capture.bin> <expect prefix>
+
+Expected output goes to <prefix>.log for ITM_PORT_LOG (itm_decode's stdout) and
+<prefix><port>.bin for the other ports, the names itm_decode gives them. Writes of every
+length from 0 to ITM_TEST_MAX_LEN cover each mix of word, halfword and byte packets. A port
+the stub leaves off (ITM_TEST_PORT_OFF) is written to as well and must not show up.
+*/
+
+#include "itm.h"
+#include <cstdio>
+#include <cstring>
+
+#define ITM_TEST_MAX_LEN    9U
+#if !defined (ITM_TEST_PORT_OFF)
+#define ITM_TEST_PORT_OFF   7U           /* make itm-test passes its own */
+#endif
+
+static std::uint32_t failures;
+
+static FILE *open_expect(const char *prefix, const char *suffix){
+  char path[256];
+  std::snprintf(path, sizeof(path), "%s%s", prefix, suffix);
+  FILE *f = std::fopen(path, "wb");
+  if(nullptr == f){
+    std::fprintf(stderr, "itm_test: can't write %s\n", path);
+  }
+  return f;
+}
+
+/* Through the ITM and straight into the expected file */
+static void test_write(std::uint32_t port, FILE *expect, const void *data, std::size_t len){
+  if(len != itm_write(port, data, len)){
+    std::fprintf(stderr, "itm_test: itm_write on port %lu didn't return %zu\n", (unsigned long)port, len);
+    failures++;
+  }
+  std::fwrite(data, 1, len, expect);
+}
+
+int main(int argc, char **argv){
+  if(argc < 3){
+    std::fprintf(stderr, "usage: itm_test <capture.bin> <expect prefix>\n");
+    return 1;
+  }
+
+  FILE *capture = std::fopen(argv[1], "wb");
+  if(nullptr == capture){
+    std::fprintf(stderr, "itm_test: can't write %s\n", argv[1]);
+    return 1;
+  }
+  FILE *log = open_expect(argv[2], ".log");
+  FILE *trace = open_expect(argv[2], "1.bin");
+  FILE *metrics = open_expect(argv[2], "2.bin");
+  if((nullptr == log) || (nullptr == trace) || (nullptr == metrics)){
+    return 1;
+  }
+
+  itm_host_capture(capture);
+
+  static_assert((ITM_PORT_LOG == 0) && (ITM_PORT_TRACE == 1) && (ITM_PORT_METRICS == 2),
+                "the expected file names assume ports 0, 1 and 2");
+
+  /* Log lines, a text of every length */
+  const char *text = "abcdefghi";
+  for(std::size_t len = 0; len <= ITM_TEST_MAX_LEN; len++){
+    char line[ITM_TEST_MAX_LEN + 32];
+    int n = std::snprintf(line, sizeof(line), "len %zu: %.*s\n", len, (int)len, text);
+    test_write(ITM_PORT_LOG, log, line, (std::size_t)n);
+    test_write(ITM_PORT_LOG, log, text, len);
+    test_write(ITM_PORT_LOG, log, "\n", 1);
+  }
+
+  /* Trace, every byte value, chunks of every length interleaved with the other ports */
+  std::uint8_t bytes[256];
+  for(std::uint32_t i = 0; i < sizeof(bytes); i++){
+    bytes[i] = (std::uint8_t)i;
+  }
+  std::size_t len = 0;
+  for(std::size_t pos = 0; pos < sizeof(bytes); pos += len){
+    len = 1 + pos % ITM_TEST_MAX_LEN;
+    if(len > sizeof(bytes) - pos){
+      len = sizeof(bytes) - pos;
+    }
+    test_write(ITM_PORT_TRACE, trace, bytes + pos, len);
+
+    std::uint32_t word = 0xA5000000U | (std::uint32_t)pos;
+    itm_send_word(ITM_PORT_METRICS, word);
+    std::fwrite(&word, 1, sizeof(word), metrics);       /* the stub is little endian, so is the ITM */
+
+    if(itm_enabled(ITM_TEST_PORT_OFF) || (len != itm_write(ITM_TEST_PORT_OFF, bytes + pos, len))){
+      std::fprintf(stderr, "itm_test: port %lu is on\n", (unsigned long)ITM_TEST_PORT_OFF);
+      failures++;
+    }
+  }
+
+  /* Metrics through itm_write too, a word and a tail */
+  test_write(ITM_PORT_METRICS, metrics, bytes, 7);
+
+  itm_host_capture(nullptr);
+  std::fclose(capture);
+  std::fclose(log);
+  std::fclose(trace);
+  std::fclose(metrics);
+  return (0 != failures) ? 1 : 0;
+}
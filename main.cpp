@@ -1,8 +1,39 @@
+#include "bench.h"
+#include "clock.h"
+#include "console.h"
+#include "fault.h"
+#include "itm.h"
+#include "sdram.h"
+#include "startup.h"
+#include "stack.h"
 
 int main();
 
 
 int main(){
-  
+
+  console_init();
+  itm_init(ITM_SWO_BAUD);
+#if !defined (HOMA_NO_HEAP)
+  fault_report();
+  boot_record_dump();
+  SystemClock_Report();
+#if defined (DATA_IN_ExtSDRAM)
+  sdram_report();
+#endif
+#else
+  /* The reports use printf and newlib's stdio (vsnprintf too) reaches malloc, see new_delete.h.
+     The crash record stays unreported until a build with a heap */
+  static const char no_reports[] = "boot: no heap, printf reports left out\n";
+  console_write(no_reports, sizeof(no_reports) - 1);
+#endif /* !HOMA_NO_HEAP */
+
+#if defined (HOMA_BENCH)
+  bench_run_all();
+  stack_scan_all();
+  stack_report();
+#endif
+
+  console_flush();
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,26 @@
+#include "mpu.h"
+
+extern std::uint32_t _estack;           /* Symbols defined in the linker script */
+extern std::uint32_t _Min_Stack_Size;
+
+void mpu_guard_init(void){
+  std::uint32_t bottom = (std::uint32_t)&_estack - (std::uint32_t)&_Min_Stack_Size;
+
+  MPU->CTRL = 0;
+
+  MPU->RNR = MPU_GUARD_TASK_REGION;
+  MPU->RASR = 0;
+
+  MPU->RBAR = mpu_guard_address((const void *)bottom) | MPU_RBAR_VALID_Msk | MPU_GUARD_MSP_REGION;
+  MPU->RASR = MPU_GUARD_RASR;
+
+  MPU->CTRL = MPU_CTRL_PRIVDEFENA_Msk | MPU_CTRL_ENABLE_Msk;
+  __DSB();
+  __ISB();
+}
+
+void mpu_guard_task_off(void){
+  MPU->RNR = MPU_GUARD_TASK_REGION;
+  MPU->RASR = 0;
+  __DSB();
+}
@@ -0,0 +1,77 @@
+#ifndef __MPU_H
+#define __MPU_H
+
+#include "homa_base.h"
+#include "memory_map.h"
+
+/*
+Stack guards in the MPU.
+
+A guard is the smallest region the MPU has, MPU_GUARD_BYTES, no access for anyone and never
+executable, at the bottom of a stack. A push or a local that runs past the bottom hits it and
+takes a MemManage fault right there, which fault.cpp records, instead of quietly overwriting
+whatever lies below. There's nothing to do per call, unlike a canary checked in a prologue.
+
+Two regions are used, the highest numbered ones so they win over anything else mapped later.
+MPU_GUARD_MSP_REGION is fixed, it guards the MSP stack reserved at the top of SRAM and is set
+by mpu_guard_init from Reset_Handler. MPU_GUARD_TASK_REGION guards the running task's stack,
+the context switch moves it:
+
+  alignas(MPU_GUARD_BYTES) static std::uint32_t blink_stack[128];
+  task->guard = mpu_guard_address(blink_stack);     // task creation
+  stack_register("blink", blink_stack, sizeof(blink_stack));
+  ...
+  mpu_guard_switch(next->guard);                    // PendSV, before switching stacks
+
+The background map (PRIVDEFENA) stays on for privileged code, so everything else keeps the
+default memory map. The MPU is off in HardFault and NMI (HFNMIENA clear), a MemManage fault
+that can't stack its frame because the guard is in the way escalates to a HardFault that then
+runs normally.
+
+A guard only catches what lands in it. A function whose frame is bigger than MPU_GUARD_BYTES
+can move sp past the guard in one step and store below it first, an array on the stack can be
+indexed past it, and neither faults. Frames that size need their stack sized with margin (see
+the high-water marks in stack.h) or a guard as big as the largest frame; MPU_GUARD_BYTES
+catches the common case of a stack creeping down, not every overflow.
+
+The guard is the first MPU_GUARD_BYTES aligned block inside the stack, a stack that isn't
+aligned to MPU_GUARD_BYTES loses what's below that as well. stack.cpp leaves the guard out of
+painting and scanning, reading it is a fault too.
+*/
+
+#define MPU_GUARD_BYTES         32U       /* smallest region, aligned to its size */
+#define MPU_GUARD_MSP_REGION    6U
+#define MPU_GUARD_TASK_REGION   7U        /* where regions overlap the highest number wins */
+
+/* AP 0 (no access), XN, size field log2(bytes) - 1 */
+#define MPU_GUARD_RASR   (MPU_RASR_XN_Msk | (0U << MPU_RASR_AP_Pos) | (4U << MPU_RASR_SIZE_Pos) | MPU_RASR_ENABLE_Msk)
+
+static_assert((1U << (((MPU_GUARD_RASR & MPU_RASR_SIZE_Msk) >> MPU_RASR_SIZE_Pos) + 1U)) == MPU_GUARD_BYTES,
+              "MPU_GUARD_RASR size field doesn't match MPU_GUARD_BYTES");
+
+/* Guard of a stack whose lowest address is stack_base */
+inline std::uint32_t mpu_guard_address(const void *stack_base){
+  return ((std::uint32_t)stack_base + MPU_GUARD_BYTES - 1U) & ~(MPU_GUARD_BYTES - 1U);
+}
+
+/* Lowest usable address of that stack, right above its guard */
+inline void *mpu_guard_stack_floor(const void *stack_base){
+  return (void *)(mpu_guard_address(stack_base) + MPU_GUARD_BYTES);
+}
+
+/* Guard the MSP stack and turn the MPU on, the task guard starts disabled */
+void mpu_guard_init(void);
+
+/* Move the task guard to guard (from mpu_guard_address). RBAR with VALID selects the region
+   and sets its base in one store, RASR enables it. The DSB makes sure the new map is in
+   place before the switch goes on, exception return does what an ISB would */
+inline void mpu_guard_switch(std::uint32_t guard){
+  MPU->RBAR = guard | MPU_RBAR_VALID_Msk | MPU_GUARD_TASK_REGION;
+  MPU->RASR = MPU_GUARD_RASR;
+  __DSB();
+}
+
+/* No task guard, for a switch to a task without one */
+void mpu_guard_task_off(void);
+
+#endif
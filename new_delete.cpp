@@ -0,0 +1,155 @@
+#include "new_delete.h"
+#include "heap.h"
+#include <new>
+
+#if !defined (HOMA_NO_HEAP)
+
+static void *new_heap_alloc(std::size_t size, std::size_t align, void *ctx){
+  return heap_memalign((MemRegion)(std::uintptr_t)ctx, align, size);
+}
+
+static void new_heap_free(void *ptr, std::size_t size, void *ctx){
+  (void)size;
+  (void)ctx;
+  heap_free(ptr);
+}
+
+static NewAllocator new_allocator = {new_heap_alloc, new_heap_free, (void *)(std::uintptr_t)NEW_DEFAULT_REGION};
+
+NewAllocator new_allocator_set(const NewAllocator &allocator){
+  NewAllocator old = new_allocator;
+  new_allocator = allocator;
+  return old;
+}
+
+NewAllocator new_allocator_default(void){
+  return {new_heap_alloc, new_heap_free, (void *)(std::uintptr_t)NEW_DEFAULT_REGION};
+}
+
+static void *new_nothrow(std::size_t size, std::size_t align){
+  /* new of 0 bytes still has to return a unique pointer */
+  return new_allocator.alloc((0 != size) ? size : 1, align, new_allocator.ctx);
+}
+
+static void *new_or_trap(std::size_t size, std::size_t align){
+  void *ptr = new_nothrow(size, align);
+  if(nullptr == ptr){
+    __builtin_trap();
+  }
+  return ptr;
+}
+
+static void delete_sized(void *ptr, std::size_t size){
+  if(nullptr != ptr){
+    new_allocator.free(ptr, size, new_allocator.ctx);
+  }
+}
+
+#else
+
+/* Never defined, see new_delete.h */
+extern "C" void HOMA_NO_HEAP_heap_reached(void);
+
+static void *new_nothrow(std::size_t size, std::size_t align){
+  (void)size;
+  (void)align;
+  HOMA_NO_HEAP_heap_reached();
+  return nullptr;
+}
+
+static void *new_or_trap(std::size_t size, std::size_t align){
+  return new_nothrow(size, align);
+}
+
+/* Deleting destructors in vtables refer to delete whether or not anything is ever newed,
+   so delete can't be the link error. Nothing newed means nothing to delete */
+static void delete_sized(void *ptr, std::size_t size){
+  (void)size;
+  if(nullptr != ptr){
+    __builtin_trap();
+  }
+}
+
+#endif /* !HOMA_NO_HEAP */
+
+#define NEW_ALIGN   __STDCPP_DEFAULT_NEW_ALIGNMENT__
+
+void *operator new(std::size_t size){
+  return new_or_trap(size, NEW_ALIGN);
+}
+
+void *operator new[](std::size_t size){
+  return new_or_trap(size, NEW_ALIGN);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return new_nothrow(size, NEW_ALIGN);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return new_nothrow(size, NEW_ALIGN);
+}
+
+void *operator new(std::size_t size, std::align_val_t align){
+  return new_or_trap(size, (std::size_t)align);
+}
+
+void *operator new[](std::size_t size, std::align_val_t align){
+  return new_or_trap(size, (std::size_t)align);
+}
+
+void *operator new(std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+  return new_nothrow(size, (std::size_t)align);
+}
+
+void *operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+  return new_nothrow(size, (std::size_t)align);
+}
+
+void operator delete(void *ptr) noexcept {
+  delete_sized(ptr, 0);
+}
+
+void operator delete[](void *ptr) noexcept {
+  delete_sized(ptr, 0);
+}
+
+void operator delete(void *ptr, std::size_t size) noexcept {
+  delete_sized(ptr, size);
+}
+
+void operator delete[](void *ptr, std::size_t size) noexcept {
+  delete_sized(ptr, size);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+  delete_sized(ptr, 0);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+  delete_sized(ptr, 0);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept {
+  delete_sized(ptr, 0);
+}
+
+void operator delete[](void *ptr, std::align_val_t) noexcept {
+  delete_sized(ptr, 0);
+}
+
+void operator delete(void *ptr, std::size_t size, std::align_val_t) noexcept {
+  delete_sized(ptr, size);
+}
+
+void operator delete[](void *ptr, std::size_t size, std::align_val_t) noexcept {
+  delete_sized(ptr, size);
+}
+
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept {
+  delete_sized(ptr, 0);
+}
+
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept {
+  delete_sized(ptr, 0);
+}
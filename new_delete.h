@@ -0,0 +1,50 @@
+#ifndef __NEW_DELETE_H
+#define __NEW_DELETE_H
+
+#include "homa_base.h"
+#include "sysmem.h"
+
+/*
+Global operator new and delete, every variant (array, nothrow, sized, aligned), go through
+one NewAllocator instead of libstdc++'s malloc based ones. The default allocates from the
+NEW_DEFAULT_REGION heap (heap.h) with the type's alignment. A subsystem can point it
+somewhere else for a while, an arena or a pool:
+
+  static void *arena_new(std::size_t size, std::size_t align, void *ctx){
+    return ((Arena *)ctx)->alloc(size, align);
+  }
+  static void arena_delete(void *, std::size_t, void *){}
+
+  NewAllocator old = new_allocator_set({arena_new, arena_delete, &request_arena});
+  ...
+  new_allocator_set(old);
+
+There are no exceptions (-fno-exceptions), a plain new that can't allocate traps, which
+leaves a crash record (fault.h). The nothrow variants return nullptr.
+
+make NO_HEAP=1 (HOMA_NO_HEAP) is a build without a dynamic heap. heap.cpp compiles to nothing,
+and _sbrk and operator new refer to the undefined symbol HOMA_NO_HEAP_heap_reached. The
+build links with --gc-sections, so that symbol (or a missing heap_ function) only turns
+into a link error if code that's really kept calls malloc, new or the heap, and the error
+names the function that does. delete traps instead, vtables refer to it regardless.
+newlib's stdio allocates its buffers with malloc, and even vsnprintf keeps a realloc path,
+so printf and friends are out in such a build. main leaves its reports out and writes
+straight to the console instead; BENCH=1 times malloc and can't be combined with it.
+*/
+
+#define NEW_DEFAULT_REGION   MEM_REGION_SRAM
+
+struct NewAllocator {
+  void *(*alloc)(std::size_t size, std::size_t align, void *ctx);   /* nullptr when out of memory */
+  void (*free)(void *ptr, std::size_t size, void *ctx);              /* size 0 if delete doesn't know it */
+  void *ctx;
+};
+
+/* Route new and delete to allocator, returns the one it replaces. Memory has to go back to
+   the allocator it came from, switch only while nothing allocated before is deleted */
+NewAllocator new_allocator_set(const NewAllocator &allocator);
+
+/* The NEW_DEFAULT_REGION heap */
+NewAllocator new_allocator_default(void);
+
+#endif
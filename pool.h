@@ -0,0 +1,157 @@
+#ifndef __POOL_H
+#define __POOL_H
+
+#include "homa_base.h"
+#include <atomic>
+#include <new>
+#include <utility>
+
+#if defined (__arm__)
+#include "core_reg_funcs.h"
+#endif /* __arm__ */
+
+/*
+Fixed size block pool. Pool<T, N> reserves room for N objects of type T inside itself and
+keeps freed blocks on a singly linked free list. alloc pops the head, free pushes onto it,
+a few instructions each and no search. Blocks that were never handed out aren't on the list,
+alloc takes them in order from a counter once the list is empty. The constructor only
+zeroes, so it's constexpr and a global pool is plain .bss with nothing to run at startup.
+
+Both ends use LDREX/STREX on the list head (and alloc on the counter) instead of masking
+interrupts, so the same pool can be used from thread code and from any ISR. The Cortex-M4
+clears the exclusive monitor on exception entry and return, so an ISR that ran between the
+LDREX and the STREX (and maybe popped and pushed the same block, the ABA case) always makes
+the STREX fail and the loop retry. No counter or tag needed next to the head.
+
+The host build (anything that isn't __arm__) uses a compare and swap instead, fine for
+single threaded host tests, not ABA safe across threads.
+
+  struct Message { std::uint32_t id; std::uint8_t payload[60]; };
+  Pool<Message, 32> messages;
+
+  Message *m = messages.create();      // nullptr when all 32 are out
+  ...
+  messages.destroy(m);
+*/
+
+template <typename T, std::size_t N>
+class Pool {
+public:
+  constexpr Pool() : slots{}, head(nullptr), fresh(0) {}
+
+  Pool(const Pool &) = delete;
+  Pool &operator=(const Pool &) = delete;
+
+  /* Uninitialized storage for one T, nullptr if the pool is empty */
+  void *alloc(){
+    Slot *top = pop();
+    if(nullptr != top){
+      return top->storage;
+    }
+
+    /* List empty, take a block that was never handed out */
+    std::uint32_t next;
+#if defined (__arm__)
+    do{
+      next = __LDREXW(&fresh);
+      if(next >= N){
+        __CLREX();
+        /* All handed out once, something may have been freed since the pop */
+        top = pop();
+        return (nullptr != top) ? top->storage : nullptr;
+      }
+    }while(__STREXW(next + 1U, &fresh));
+#else
+    next = __atomic_load_n(&fresh, __ATOMIC_RELAXED);
+    do{
+      if(next >= N){
+        top = pop();
+        return (nullptr != top) ? top->storage : nullptr;
+      }
+    }while(!__atomic_compare_exchange_n(&fresh, &next, next + 1U, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+#endif /* __arm__ */
+    return slots[next].storage;
+  }
+
+  /* Hand storage from alloc back, nullptr is ignored */
+  void free(void *ptr){
+    if(nullptr == ptr){
+      return;
+    }
+    Slot *slot = (Slot *)ptr;
+#if defined (__arm__)
+    do{
+      slot->next = (Slot *)__LDREXW((volatile std::uint32_t *)&head);
+      /* next has to be in memory before the block is visible on the list */
+      std::atomic_signal_fence(std::memory_order_release);
+    }while(__STREXW((std::uint32_t)slot, (volatile std::uint32_t *)&head));
+#else
+    Slot *top = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    do{
+      slot->next = top;
+    }while(!__atomic_compare_exchange_n(&head, &top, slot, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+#endif /* __arm__ */
+  }
+
+  /* alloc plus constructor, destroy is destructor plus free */
+  template <typename... Args>
+  T *create(Args &&...args){
+    void *ptr = alloc();
+    return (nullptr != ptr) ? new(ptr) T(std::forward<Args>(args)...) : nullptr;
+  }
+
+  void destroy(T *object){
+    if(nullptr != object){
+      object->~T();
+      free(object);
+    }
+  }
+
+  /* ptr is a block of this pool */
+  bool owns(const void *ptr) const {
+    const std::uint8_t *p = (const std::uint8_t *)ptr;
+    const std::uint8_t *first = (const std::uint8_t *)&slots[0];
+    return (p >= first) && (p < (const std::uint8_t *)&slots[N]) && (0 == (std::size_t)(p - first) % sizeof(Slot));
+  }
+
+  static constexpr std::size_t capacity(){
+    return N;
+  }
+
+private:
+  union Slot {
+    Slot *next;
+    alignas(T) std::uint8_t storage[sizeof(T)];
+  };
+
+  static_assert(N > 0, "empty pool");
+  static_assert(N <= 0xFFFFFFFFU, "fresh counts blocks in 32 bits");
+
+  /* Head of the free list, nullptr if it's empty */
+  Slot *pop(){
+    Slot *top;
+#if defined (__arm__)
+    do{
+      top = (Slot *)__LDREXW((volatile std::uint32_t *)&head);
+      if(nullptr == top){
+        __CLREX();
+        return nullptr;
+      }
+    }while(__STREXW((std::uint32_t)top->next, (volatile std::uint32_t *)&head));
+#else
+    top = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    do{
+      if(nullptr == top){
+        return nullptr;
+      }
+    }while(!__atomic_compare_exchange_n(&head, &top, top->next, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+#endif /* __arm__ */
+    return top;
+  }
+
+  Slot slots[N];
+  Slot *volatile head;
+  volatile std::uint32_t fresh;   /* slots[fresh] on were never handed out */
+};
+
+#endif
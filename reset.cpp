@@ -0,0 +1,109 @@
+#include "reset.h"
+#include "memory_map.h"
+#include "sections.h"
+
+#define WARM_STATE_MAGIC  0x3A4D5257U
+
+struct WarmState {
+  std::uint32_t magic;
+  std::uint32_t csr;
+  std::uint32_t cause;
+  std::uint32_t warm;
+  std::uint32_t flags;
+  std::uint32_t check;   /* ~(everything above xor'd), catches a partly overwritten record */
+};
+
+HOMA_NOINIT static WarmState warm_state;
+
+static std::uint32_t warm_state_check(){
+  return ~(warm_state.magic ^ warm_state.csr ^ warm_state.cause ^ warm_state.warm ^ warm_state.flags);
+}
+
+static bool warm_state_intact(){
+  return (WARM_STATE_MAGIC == warm_state.magic) && (warm_state_check() == warm_state.check);
+}
+
+/* Power on also sets BOR and PIN, and every internal reset drives NRST so PIN is set
+   for all of them. Check the specific flags first and fall back to PIN last */
+static ResetCause reset_decode(std::uint32_t csr){
+  if(csr & RCC_CSR_PORRSTF){
+    return RESET_CAUSE_POWER_ON;
+  }
+  if(csr & RCC_CSR_BORRSTF){
+    return RESET_CAUSE_BROWNOUT;
+  }
+  if(csr & RCC_CSR_LPWRRSTF){
+    return RESET_CAUSE_LOW_POWER;
+  }
+  if(csr & RCC_CSR_WWDGRSTF){
+    return RESET_CAUSE_WWDG;
+  }
+  if(csr & RCC_CSR_IWDGRSTF){
+    return RESET_CAUSE_IWDG;
+  }
+  if(csr & RCC_CSR_SFTRSTF){
+    return RESET_CAUSE_SOFTWARE;
+  }
+  if(csr & RCC_CSR_PINRSTF){
+    return RESET_CAUSE_PIN;
+  }
+  return RESET_CAUSE_UNKNOWN;
+}
+
+void reset_capture(void){
+  std::uint32_t csr = RCC->CSR;
+  RCC->CSR |= RCC_CSR_RMVF;
+
+  ResetCause cause = reset_decode(csr);
+  bool warm = warm_state_intact() &&
+              ((RESET_CAUSE_SOFTWARE == cause) || (RESET_CAUSE_IWDG == cause) || (RESET_CAUSE_WWDG == cause));
+
+  if(!warm){
+    warm_state.flags = 0;
+  }
+
+  warm_state.magic = WARM_STATE_MAGIC;
+  warm_state.csr = csr;
+  warm_state.cause = cause;
+  warm_state.warm = warm;
+  warm_state.check = warm_state_check();
+}
+
+ResetCause reset_cause(void){
+  return (ResetCause)warm_state.cause;
+}
+
+const char *reset_cause_name(ResetCause cause){
+  switch(cause){
+    case RESET_CAUSE_POWER_ON:  return "power on";
+    case RESET_CAUSE_BROWNOUT:  return "brown out";
+    case RESET_CAUSE_PIN:       return "reset pin";
+    case RESET_CAUSE_SOFTWARE:  return "software";
+    case RESET_CAUSE_IWDG:      return "independent watchdog";
+    case RESET_CAUSE_WWDG:      return "window watchdog";
+    case RESET_CAUSE_LOW_POWER: return "low power";
+    default:                    return "unknown";
+  }
+}
+
+std::uint32_t reset_flags(void){
+  return warm_state.csr;
+}
+
+bool reset_is_warm(void){
+  return warm_state.warm != 0;
+}
+
+bool warm_valid(std::uint32_t flags){
+  return reset_is_warm() && ((warm_state.flags & flags) == flags);
+}
+
+void warm_set(std::uint32_t flags){
+  warm_state.flags |= flags;
+  warm_state.check = warm_state_check();
+}
+
+void warm_clear(std::uint32_t flags){
+  warm_state.flags &= ~flags;
+  warm_state.check = warm_state_check();
+}
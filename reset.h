@@ -0,0 +1,59 @@
+#ifndef __RESET_H
+#define __RESET_H
+
+#include "homa_base.h"
+
+/*
+Reset cause decoding and the warm reset fast path.
+
+Reset_Handler calls reset_capture() before anything else. It reads the reset flags in
+RCC->CSR, clears them for the next reset and decides whether this is a warm boot: a
+software or watchdog reset with an intact warm state record in .noinit. RAM keeps its
+contents over those resets, so init code can skip work whose result is still in RAM.
+
+Work that can be skipped is tracked with warm flags. Code that sets something up whose
+result survives a reset calls warm_set() once it's done, and on the next boot checks
+warm_valid() first. Every flag is dropped on a cold boot (power on, brown out, reset pin,
+low power reset).
+
+Peripheral registers, RCC and FMC included, are back at their reset values after any
+reset, so the clock tree and the SDRAM controller always have to be brought up again. What
+a warm boot skips is the work around them:
+
+  SystemInit           the RCC reset-to-defaults writes, the hardware reset did them
+  SystemClock_Config   the HSE startup timeout, if the HSE already failed (WARM_HSE_FAILED)
+  sdram_init           the memory test, which would wipe what survived (WARM_SDRAM)
+*/
+
+enum ResetCause {
+  RESET_CAUSE_UNKNOWN,
+  RESET_CAUSE_POWER_ON,
+  RESET_CAUSE_BROWNOUT,
+  RESET_CAUSE_PIN,
+  RESET_CAUSE_SOFTWARE,
+  RESET_CAUSE_IWDG,
+  RESET_CAUSE_WWDG,
+  RESET_CAUSE_LOW_POWER
+};
+
+/* Setup that stays valid across a warm reset */
+#define WARM_SDRAM         (1U << 1)   /* SDRAM passed its memory test, contents kept */
+#define WARM_HSE_FAILED    (1U << 2)   /* HSE didn't start, SystemClock_Config goes to HSI */
+
+/* Read and clear the reset flags, called once from Reset_Handler */
+void reset_capture(void);
+
+ResetCause reset_cause(void);
+const char *reset_cause_name(ResetCause cause);
+
+/* RCC->CSR as it was at reset, before the flags were cleared */
+std::uint32_t reset_flags(void);
+
+/* Software, IWDG or WWDG reset with the warm state intact */
+bool reset_is_warm(void);
+
+bool warm_valid(std::uint32_t flags);
+void warm_set(std::uint32_t flags);
+void warm_clear(std::uint32_t flags);
+
+#endif
@@ -0,0 +1,134 @@
+/*
+Host tool, packs RAM load images (.data, .ccmram) into the .data_lz blob that Reset_Handler
+unpacks at boot. Built with the host compiler, see the final_lz.elf target in the Makefile.
+
+usage: rle_pack <out.bin> <addr> <image.bin> [<addr> <image.bin> ...]
+
+The blob is a list of records, one per image:
+
+  u32 dst          RAM address the image is unpacked to
+  u32 raw_size     size of the unpacked image
+  u32 packed_size  number of packed bytes that follow
+  u8  packed[]     RLE stream, padded with zeros to a multiple of 4
+
+RLE stream, a control byte followed by its payload:
+
+  0x00-0x7F  literal, (c + 1) bytes follow and are copied as is
+  0x80-0xFF  run, one byte follows and is repeated (c & 0x7F) + 3 times
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#define RLE_MIN_RUN      3U
+#define RLE_MAX_RUN      (0x7FU + RLE_MIN_RUN)
+#define RLE_MAX_LITERAL  0x80U
+
+static bool read_file(const char *path, std::vector<std::uint8_t> &out){
+  FILE *f = std::fopen(path, "rb");
+  if(nullptr == f){
+    return false;
+  }
+
+  std::uint8_t buf[4096];
+  std::size_t n;
+  while((n = std::fread(buf, 1, sizeof(buf), f)) > 0){
+    out.insert(out.end(), buf, buf + n);
+  }
+
+  std::fclose(f);
+  return true;
+}
+
+static void put_u32(std::vector<std::uint8_t> &out, std::uint32_t value){
+  for(int i = 0; i < 4; i++){
+    out.push_back((std::uint8_t)(value >> (8 * i)));
+  }
+}
+
+static std::size_t run_length(const std::vector<std::uint8_t> &in, std::size_t pos){
+  std::size_t n = 1;
+  while((pos + n < in.size()) && (in[pos + n] == in[pos]) && (n < RLE_MAX_RUN)){
+    n++;
+  }
+  return n;
+}
+
+static std::vector<std::uint8_t> rle_encode(const std::vector<std::uint8_t> &in){
+  std::vector<std::uint8_t> out;
+  std::size_t pos = 0;
+
+  while(pos < in.size()){
+    std::size_t run = run_length(in, pos);
+
+    if(run >= RLE_MIN_RUN){
+      out.push_back((std::uint8_t)(0x80U | (run - RLE_MIN_RUN)));
+      out.push_back(in[pos]);
+      pos += run;
+      continue;
+    }
+
+    /* Collect literals until the next run worth encoding */
+    std::size_t start = pos;
+    while((pos < in.size()) && (pos - start < RLE_MAX_LITERAL) && (run_length(in, pos) < RLE_MIN_RUN)){
+      pos++;
+    }
+
+    out.push_back((std::uint8_t)(pos - start - 1));
+    out.insert(out.end(), in.begin() + start, in.begin() + pos);
+  }
+
+  return out;
+}
+
+int main(int argc, char **argv){
+  if((argc < 4) || ((argc - 2) % 2 != 0)){
+    std::fprintf(stderr, "usage: %s <out.bin> <addr> <image.bin> [<addr> <image.bin> ...]\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<std::uint8_t> blob;
+  std::size_t raw_total = 0;
+
+  for(int i = 2; i < argc; i += 2){
+    std::uint32_t dst = (std::uint32_t)std::strtoul(argv[i], nullptr, 0);
+    std::vector<std::uint8_t> image;
+
+    if(!read_file(argv[i + 1], image)){
+      std::fprintf(stderr, "rle_pack: can't read %s\n", argv[i + 1]);
+      return 1;
+    }
+
+    /* Empty sections produce no record */
+    if(image.empty()){
+      continue;
+    }
+
+    std::vector<std::uint8_t> packed = rle_encode(image);
+
+    put_u32(blob, dst);
+    put_u32(blob, (std::uint32_t)image.size());
+    put_u32(blob, (std::uint32_t)packed.size());
+    blob.insert(blob.end(), packed.begin(), packed.end());
+    while(blob.size() % 4 != 0){
+      blob.push_back(0);
+    }
+
+    raw_total += image.size();
+    std::printf("rle_pack: %s @ 0x%08lx, %zu -> %zu bytes\n", argv[i + 1], (unsigned long)dst,
+                image.size(), packed.size());
+  }
+
+  FILE *f = std::fopen(argv[1], "wb");
+  if(nullptr == f){
+    std::fprintf(stderr, "rle_pack: can't write %s\n", argv[1]);
+    return 1;
+  }
+  std::fwrite(blob.data(), 1, blob.size(), f);
+  std::fclose(f);
+
+  std::printf("rle_pack: total %zu -> %zu bytes\n", raw_total, blob.size());
+  return 0;
+}
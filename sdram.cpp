@@ -0,0 +1,286 @@
+#include "sdram.h"
+#include "memory_map.h"
+#include "clock.h"
+#include "reset.h"
+
+#define SDRAM_AF_FMC         12U
+#define SDRAM_CMD_TIMEOUT_US 100U
+#define SDRAM_POWERUP_US     100U    /* stable clock before the first command */
+#define SDRAM_AUTO_REFRESHES 8U
+
+/* FMC pins on the Discovery board, as pin masks per GPIO port */
+struct SdramPort {
+  std::uint8_t port;    /* 0 = GPIOA, 1 = GPIOB ... */
+  std::uint16_t pins;
+};
+
+static const SdramPort sdram_ports[] = {
+  {1, (1U << 5) | (1U << 6)},                                        /* SDCKE1, SDNE1 */
+  {2, (1U << 0)},                                                    /* SDNWE */
+  {3, 0xC703U},                                                      /* D0-D3, D13-D15 */
+  {4, 0xFF83U},                                                      /* NBL0, NBL1, D4-D12 */
+  {5, 0xF83FU},                                                      /* A0-A9, SDNRAS */
+  {6, (1U << 0) | (1U << 1) | (1U << 4) | (1U << 5) | (1U << 8) | (1U << 15)},  /* A10, A11, BA0, BA1, SDCLK, SDNCAS */
+};
+
+/* Power up sequence (JEDEC), all sent to bank 2 */
+enum SdramCmdMode {
+  SDRAM_CMD_NORMAL,
+  SDRAM_CMD_CLOCK_ENABLE,
+  SDRAM_CMD_PALL,
+  SDRAM_CMD_AUTO_REFRESH,
+  SDRAM_CMD_LOAD_MODE
+};
+
+struct SdramCommand {
+  std::uint8_t mode;
+  std::uint16_t arg;        /* auto refresh count or mode register */
+  std::uint16_t wait_us;    /* after the command */
+};
+
+/* Mode register: burst length 1, sequential, CAS latency, single location write burst */
+constexpr std::uint16_t sdram_mode_register(const SdramChip &chip){
+  return (std::uint16_t)((chip.cas << 4) | (1U << 9));
+}
+
+static const SdramCommand sdram_commands[] = {
+  {SDRAM_CMD_CLOCK_ENABLE, 0, SDRAM_POWERUP_US},
+  {SDRAM_CMD_PALL, 0, 0},
+  {SDRAM_CMD_AUTO_REFRESH, SDRAM_AUTO_REFRESHES, 0},
+  {SDRAM_CMD_LOAD_MODE, sdram_mode_register(sdram_is42s16400j), 0},
+};
+
+static bool sdram_ok = false;
+static const char *sdram_error = "not brought up";  /* why sdram_ok is false */
+static std::uint32_t sdram_error_addr;
+
+static GPIO_t *sdram_gpio(std::uint32_t port){
+  return (GPIO_t *)(GPIOA_BASE + port * (GPIOB_BASE - GPIOA_BASE));
+}
+
+/* Alternate function 12, very high speed, push-pull, no pull. Only the FMC pins change */
+static void sdram_pins(){
+  for(const SdramPort &p : sdram_ports){
+    RCC->AHB1ENR |= 1U << p.port;
+  }
+  (void)RCC->AHB1ENR;
+
+  for(const SdramPort &p : sdram_ports){
+    GPIO_t *gpio = sdram_gpio(p.port);
+    for(std::uint32_t pin = 0; pin < 16; pin++){
+      if(!(p.pins & (1U << pin))){
+        continue;
+      }
+      gpio->AFR[pin >> 3] = (gpio->AFR[pin >> 3] & ~(0xFU << ((pin & 7) * 4))) | (SDRAM_AF_FMC << ((pin & 7) * 4));
+      gpio->MODER = (gpio->MODER & ~(3U << (pin * 2))) | (2U << (pin * 2));
+      gpio->OSPEEDR |= 3U << (pin * 2);
+      gpio->OTYPER &= ~(1U << pin);
+      gpio->PUPDR &= ~(3U << (pin * 2));
+    }
+  }
+}
+
+static std::uint32_t sdram_sdtr(const SdramTiming &t){
+  return ((t.tmrd - 1U) << FMC_SDTR1_TMRD_Pos) | ((t.txsr - 1U) << FMC_SDTR1_TXSR_Pos) |
+         ((t.tras - 1U) << FMC_SDTR1_TRAS_Pos) | ((t.trc - 1U) << FMC_SDTR1_TRC_Pos) |
+         ((t.twr - 1U) << FMC_SDTR1_TWR_Pos) | ((t.trp - 1U) << FMC_SDTR1_TRP_Pos) |
+         ((t.trcd - 1U) << FMC_SDTR1_TRCD_Pos);
+}
+
+static bool sdram_wait_idle(){
+  std::uint32_t deadline = clock_deadline_us(SDRAM_CMD_TIMEOUT_US);
+  while(FMC_Bank5_6->SDSR & FMC_SDSR_BUSY){
+    if(clock_expired(deadline)){
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool sdram_command(const SdramCommand &cmd){
+  std::uint32_t sdcmr = cmd.mode | FMC_SDCMR_CTB2;
+  if(SDRAM_CMD_AUTO_REFRESH == cmd.mode){
+    sdcmr |= (std::uint32_t)(cmd.arg - 1U) << FMC_SDCMR_NRFS_Pos;
+  }
+  else if(SDRAM_CMD_LOAD_MODE == cmd.mode){
+    sdcmr |= (std::uint32_t)cmd.arg << FMC_SDCMR_MRD_Pos;
+  }
+
+  if(!sdram_wait_idle()){
+    return false;
+  }
+  FMC_Bank5_6->SDCMR = sdcmr;
+  if(!sdram_wait_idle()){
+    return false;
+  }
+
+  if(0 != cmd.wait_us){
+    clock_delay_us(cmd.wait_us);
+  }
+  return true;
+}
+
+static void sdram_fmc(const SdramChip &chip){
+  RCC->AHB3ENR |= RCC_AHB3ENR_FMCEN;
+  (void)RCC->AHB3ENR;
+
+  /* SDCLK, RBURST, RPIPE, TRC and TRP are only taken from the bank 1 registers */
+  FMC_Bank5_6->SDCR[0] = (2U << FMC_SDCR1_SDCLK_Pos) | (1U << FMC_SDCR1_RPIPE_Pos);
+  FMC_Bank5_6->SDCR[1] = ((chip.col_bits - 8U) << FMC_SDCR1_NC_Pos) | ((chip.row_bits - 11U) << FMC_SDCR1_NR_Pos) |
+                         ((chip.bus_bits >> 4) << FMC_SDCR1_MWID_Pos) | ((chip.banks >> 2) << FMC_SDCR1_NB_Pos) |
+                         ((std::uint32_t)chip.cas << FMC_SDCR1_CAS_Pos) | FMC_SDCR1_WP;
+
+  sdram_set_timing(sdram_default_timing);
+}
+
+void sdram_set_timing(const SdramTiming &timing){
+  std::uint32_t sdtr = sdram_sdtr(timing);
+  FMC_Bank5_6->SDTR[0] = sdtr;
+  FMC_Bank5_6->SDTR[1] = sdtr;
+}
+
+static void sdram_set_refresh(std::uint32_t hclk){
+  FMC_Bank5_6->SDRTR = (FMC_Bank5_6->SDRTR & ~FMC_SDRTR_COUNT) |
+                       (sdram_refresh_count(sdram_is42s16400j, hclk / 2) << FMC_SDRTR_COUNT_Pos);
+}
+
+/* A switch passes through the 16 MHz HSI, refresh for that during it (too often is only a
+   bit of bandwidth at the faster clocks) and for the new clock after it */
+static void sdram_clock_changed(ClockEvent event, const ClockFreqs &freqs, void *){
+  sdram_set_refresh((CLOCK_PRE_CHANGE == event) ? HSI_VALUE : freqs.hclk);
+}
+
+static bool sdram_test_boot(std::uint32_t *fail_addr);
+
+bool sdram_init(void){
+  sdram_pins();
+  sdram_fmc(sdram_is42s16400j);
+
+  for(const SdramCommand &cmd : sdram_commands){
+    if(!sdram_command(cmd)){
+      sdram_error = "FMC command timed out";
+      return false;
+    }
+  }
+
+  sdram_set_refresh(SystemCoreClock);
+  FMC_Bank5_6->SDCR[1] &= ~FMC_SDCR1_WP;
+
+  /* Contents survived a warm reset, don't test (and wipe) them */
+  if(!warm_valid(WARM_SDRAM)){
+    std::uint32_t fail_addr;
+    if(!sdram_test_boot(&fail_addr)){
+      sdram_error = "memory test failed";
+      sdram_error_addr = fail_addr;
+      return false;
+    }
+    warm_set(WARM_SDRAM);
+  }
+
+  clock_listener_add(sdram_clock_changed, nullptr);
+  sdram_ok = true;
+  return true;
+}
+
+bool sdram_ready(void){
+  return sdram_ok;
+}
+
+void sdram_report(void){
+  if(sdram_ok){
+    printf("sdram: %luK at 0x%08lx\n", (unsigned long)(sdram_default_size / 1024U), (unsigned long)SDRAM_BANK2_BASE);
+  }
+  else if(0 != sdram_error_addr){
+    printf("sdram: %s at 0x%08lx, SDRAM region empty\n", sdram_error, (unsigned long)sdram_error_addr);
+  }
+  else{
+    printf("sdram: %s, SDRAM region empty\n", sdram_error);
+  }
+}
+
+/* Walking ones over the data bus on the first word */
+static bool sdram_test_data_bus(volatile std::uint32_t *base, std::uint32_t *fail_addr){
+  for(std::uint32_t bit = 1; bit != 0; bit <<= 1){
+    *base = bit;
+    if(*base != bit){
+      *fail_addr = (std::uint32_t)base;
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Every power of 2 word offset below words gets its own value, a stuck or shorted address
+   line makes two of them alias. Only lines below words are covered */
+static bool sdram_test_address_bus(volatile std::uint32_t *base, std::uint32_t words, std::uint32_t *fail_addr){
+  base[0] = 0x55555555U;
+  for(std::uint32_t offset = 1; offset < words; offset <<= 1){
+    base[offset] = 0x55555555U;
+  }
+
+  base[0] = 0xAAAAAAAAU;
+  for(std::uint32_t offset = 1; offset < words; offset <<= 1){
+    if(base[offset] != 0x55555555U){
+      *fail_addr = (std::uint32_t)&base[offset];
+      return false;
+    }
+  }
+  base[0] = 0x55555555U;
+
+  for(std::uint32_t test = 1; test < words; test <<= 1){
+    base[test] = 0xAAAAAAAAU;
+    for(std::uint32_t offset = 1; offset < words; offset <<= 1){
+      if((offset != test) && (base[offset] != 0x55555555U)){
+        *fail_addr = (std::uint32_t)&base[test];
+        return false;
+      }
+    }
+    base[test] = 0x55555555U;
+  }
+  return true;
+}
+
+/* Each word holds its own address, then the inverse, catches cells that don't hold a value */
+static bool sdram_test_cells(volatile std::uint32_t *base, std::uint32_t words, std::uint32_t *fail_addr){
+  for(std::uint32_t i = 0; i < words; i++){
+    base[i] = (std::uint32_t)&base[i];
+  }
+  for(std::uint32_t i = 0; i < words; i++){
+    if(base[i] != (std::uint32_t)&base[i]){
+      *fail_addr = (std::uint32_t)&base[i];
+      return false;
+    }
+    base[i] = ~(std::uint32_t)&base[i];
+  }
+  for(std::uint32_t i = 0; i < words; i++){
+    if(base[i] != ~(std::uint32_t)&base[i]){
+      *fail_addr = (std::uint32_t)&base[i];
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Boot test, nothing lives in the SDRAM yet so the address bus gets the whole chip */
+static bool sdram_test_boot(std::uint32_t *fail_addr){
+  volatile std::uint32_t *base = (volatile std::uint32_t *)SDRAM_BANK2_BASE;
+  return sdram_test_data_bus(base, fail_addr) &&
+         sdram_test_address_bus(base, sdram_default_size / sizeof(std::uint32_t), fail_addr) &&
+         sdram_test_cells(base, SDRAM_BOOT_TEST_BYTES / sizeof(std::uint32_t), fail_addr);
+}
+
+bool sdram_test(void *base, std::uint32_t bytes, std::uint32_t *fail_addr){
+  std::uint32_t start = (std::uint32_t)base;
+  if((start < SDRAM_BANK2_BASE) || (start - SDRAM_BANK2_BASE >= sdram_default_size)){
+    *fail_addr = start;
+    return false;
+  }
+  if(bytes > SDRAM_BANK2_BASE + sdram_default_size - start){
+    bytes = SDRAM_BANK2_BASE + sdram_default_size - start;
+  }
+
+  volatile std::uint32_t *p = (volatile std::uint32_t *)base;
+  std::uint32_t words = bytes / sizeof(std::uint32_t);
+  return sdram_test_data_bus(p, fail_addr) && sdram_test_address_bus(p, words, fail_addr) &&
+         sdram_test_cells(p, words, fail_addr);
+}
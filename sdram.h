@@ -0,0 +1,127 @@
+#ifndef __SDRAM_H
+#define __SDRAM_H
+
+#include "homa_base.h"
+#include "clock_tree.h"
+
+/*
+External SDRAM on FMC bank 2, brought up from SystemInit (make SDRAM=1).
+
+The chip is described as data, sizes in address bits and timings in ns (or clocks where
+the datasheet gives clocks), and converted to SDCR/SDTR fields for the SDCLK in use at
+compile time. Init walks a pin table and a command table, waits are timed in us on the DWT
+cycle counter instead of counted loops.
+
+SDCLK follows HCLK, so on a clock_set_speed switch the refresh rate is recomputed for the
+new clock. The SDTR timings worked out for 180 MHz only get more conservative below it.
+
+On a cold boot the memory is tested before use. A warm reset keeps SDRAM contents (the
+refresh stops only for the reset itself, a few us) so the test, which destroys them, is
+skipped when WARM_SDRAM (reset.h) is still valid.
+*/
+
+#define SDRAM_BANK2_BASE   0xD0000000U
+
+/* Test size on a cold boot: data and address bus over the whole chip, then the
+   full pattern test over this many bytes from the start */
+#ifndef SDRAM_BOOT_TEST_BYTES
+#define SDRAM_BOOT_TEST_BYTES   (64U * 1024U)
+#endif
+
+struct SdramChip {
+  std::uint8_t row_bits;      /* 11-13 */
+  std::uint8_t col_bits;      /* 8-11 */
+  std::uint8_t bus_bits;      /* 8, 16 or 32 */
+  std::uint8_t banks;         /* 2 or 4 */
+  std::uint8_t cas;           /* CAS latency in clocks, 1-3 */
+  std::uint8_t tmrd_clk;      /* load mode register to active */
+  std::uint8_t twr_clk;       /* write recovery */
+  std::uint16_t txsr_ns;      /* exit self refresh to active */
+  std::uint16_t tras_ns;      /* active to precharge (self refresh time) */
+  std::uint16_t trc_ns;       /* row cycle */
+  std::uint16_t trp_ns;       /* precharge to active */
+  std::uint16_t trcd_ns;      /* active to read/write */
+  std::uint16_t refresh_ms;   /* every row is refreshed within this */
+};
+
+/* SDTR fields in SDCLK cycles, 1-16 each */
+struct SdramTiming {
+  std::uint8_t tmrd;
+  std::uint8_t txsr;
+  std::uint8_t tras;
+  std::uint8_t trc;
+  std::uint8_t twr;
+  std::uint8_t trp;
+  std::uint8_t trcd;
+};
+
+/* IS42S16400J-7 on the STM32F429I Discovery: 1M x 16 x 4 banks, 8M */
+constexpr SdramChip sdram_is42s16400j = {12, 8, 16, 4, 3, 2, 2, 70, 42, 63, 15, 15, 64};
+
+/* SDCLK is HCLK / 2, the fastest the FMC can do */
+constexpr std::uint32_t sdram_sdclk = SysClock::hclk / 2;
+
+constexpr std::uint32_t sdram_size(const SdramChip &chip){
+  return (1U << (chip.row_bits + chip.col_bits)) * chip.banks * (chip.bus_bits / 8);
+}
+
+constexpr std::uint8_t sdram_clocks(std::uint32_t ns, std::uint32_t sdclk){
+  /* Rounded up, ns * MHz / 1000 */
+  return (std::uint8_t)((ns * (sdclk / 1000000U) + 999U) / 1000U);
+}
+
+constexpr SdramTiming sdram_timing(const SdramChip &chip, std::uint32_t sdclk){
+  SdramTiming t = {chip.tmrd_clk, sdram_clocks(chip.txsr_ns, sdclk), sdram_clocks(chip.tras_ns, sdclk),
+                   sdram_clocks(chip.trc_ns, sdclk), chip.twr_clk, sdram_clocks(chip.trp_ns, sdclk),
+                   sdram_clocks(chip.trcd_ns, sdclk)};
+
+  /* The FMC also needs TWR >= TRAS - TRCD and TWR >= TRC - TRCD - TRP (RM0090 37.7.5) */
+  if(t.twr < t.tras - t.trcd){
+    t.twr = (std::uint8_t)(t.tras - t.trcd);
+  }
+  if(t.twr < t.trc - t.trcd - t.trp){
+    t.twr = (std::uint8_t)(t.trc - t.trcd - t.trp);
+  }
+  return t;
+}
+
+constexpr bool sdram_timing_valid(const SdramTiming &t){
+  return (t.tmrd >= 1) && (t.tmrd <= 16) && (t.txsr >= 1) && (t.txsr <= 16) && (t.tras >= 1) && (t.tras <= 16) &&
+         (t.trc >= 1) && (t.trc <= 16) && (t.twr >= 1) && (t.twr <= 16) && (t.trp >= 1) && (t.trp <= 16) &&
+         (t.trcd >= 1) && (t.trcd <= 16);
+}
+
+/* SDRTR COUNT: one row refresh every refresh_ms / rows, minus the 20 clock safety margin.
+   Also used at runtime when the clock changes, so 32 bit only */
+constexpr std::uint32_t sdram_refresh_count(const SdramChip &chip, std::uint32_t sdclk){
+  return chip.refresh_ms * (sdclk / 1000U) / (1U << chip.row_bits) - 20U;
+}
+
+constexpr SdramTiming sdram_default_timing = sdram_timing(sdram_is42s16400j, sdram_sdclk);
+constexpr std::uint32_t sdram_default_size = sdram_size(sdram_is42s16400j);
+
+static_assert(sdram_timing_valid(sdram_default_timing), "SDRAM timing doesn't fit SDTR at this SDCLK");
+static_assert(sdram_refresh_count(sdram_is42s16400j, sdram_sdclk) > 41, "SDRAM refresh count too low");
+static_assert(sdram_default_size == 8U * 1024U * 1024U, "linker script SDRAM length is 8M");
+
+/* Pins, FMC and the power up command sequence, then the memory test (cold boot only).
+   False if a command timed out or the test failed, the SDRAM region stays empty then */
+bool sdram_init(void);
+
+/* sdram_init has run and passed */
+bool sdram_ready(void);
+
+/* Print whether the SDRAM came up and, if not, what failed. SystemInit runs before there is
+   a console, so this is how a failed bring-up gets seen */
+void sdram_report(void);
+
+/* Reprogram SDTR, for tuning. Nothing may access the SDRAM meanwhile */
+void sdram_set_timing(const SdramTiming &timing);
+
+/* Data bus, address bus and a pattern test over bytes from base, which has to be a word
+   aligned SDRAM address. Only that range is written and its contents are destroyed, the
+   address bus test only covers the lines below bytes. Returns true if it passed, else the
+   first failing address is stored in fail_addr */
+bool sdram_test(void *base, std::uint32_t bytes, std::uint32_t *fail_addr);
+
+#endif
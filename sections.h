@@ -0,0 +1,77 @@
+#ifndef __SECTIONS_H
+#define __SECTIONS_H
+
+#include "homa_base.h"
+
+/*
+Placement attributes for the memory regions defined in linker_script.ld.
+
+CCM (core coupled memory, 64K at 0x10000000) is only connected to the core's D-bus. Loads
+and stores to it are zero wait state and never stall behind DMA or the other bus masters
+that share SRAM1/SRAM2, which makes it the place for hot kernel data, task stacks and ISR
+state. Two things can't go there: buffers that a DMA stream reads or writes, and code.
+
+  HOMA_CCM_DATA int table[4] = {1, 2, 3, 4};   // initialized, copied from flash at boot
+  HOMA_CCM_BSS  Scheduler sched;               // zeroed at boot
+  HOMA_CCM_BSS  TaskStack<1024> idle_stack;    // task stack in CCM
+*/
+
+#define HOMA_CCM_DATA   [[gnu::section(".ccmram")]]
+#define HOMA_CCM_BSS    [[gnu::section(".ccmbss")]]
+
+/*
+Functions that run from SRAM. Flash at full speed needs 5 wait states and only the ART
+cache hides them, RAM code always runs zero wait state. The code is copied from flash
+together with .data. long_call is needed because flash and SRAM are further apart than
+a BL can reach.
+
+  HOMA_RAMFUNC void TIM2_Handler(void){ ... }        // ISR in RAM, the flash table points at it
+  HOMA_RAMFUNC static void fast_path(){ ... }
+
+A RAM ISR can also be attached at runtime with NVIC_SetVector when the vector table is
+in SRAM as well (make VECTORS=sram), which also takes the vector fetch off flash.
+*/
+#define HOMA_RAMFUNC    [[gnu::section(".RamFunc"), gnu::noinline, gnu::long_call]]
+
+/*
+Zero initialized buffers that Reset_Handler doesn't clear. They are zeroed in the background
+with boot_deferred_zero_step (idle loop) or all at once with boot_deferred_zero_finish,
+which must have been called before the first access (see startup.h). Only use it for plain
+data without constructors, a constructor would run before the memory is cleared.
+
+  HOMA_DEFERRED_BSS static std::uint8_t frame_buffer[64 * 1024];
+*/
+#define HOMA_DEFERRED_BSS   [[gnu::section(".bss_deferred")]]
+
+/*
+Data that is neither initialized nor cleared at boot and keeps its value across a reset
+(not across power loss). Validate it with a magic number before trusting it.
+
+  HOMA_NOINIT static CrashRecord last_crash;
+*/
+#define HOMA_NOINIT   [[gnu::section(".noinit")]]
+
+/*
+Buffers in the 8M external SDRAM, only with make SDRAM=1. SDRAM is slower than SRAM, shared
+with the LTDC and DMA2D, and only usable once SystemInit has set up the FMC, which is after
+.bss is cleared and after the constructors ran. So it's neither cleared nor constructed:
+plain data only, written before it's read.
+
+  HOMA_SDRAM static std::uint16_t frame_buffer[240 * 320];
+*/
+#define HOMA_SDRAM    [[gnu::section(".sdram")]]
+
+/* Task stack storage, 8 byte aligned as required by AAPCS. Bytes must be a multiple of 8 */
+template <std::size_t Bytes>
+struct alignas(8) TaskStack {
+  static_assert(Bytes % 8 == 0, "stack size must be a multiple of 8 bytes");
+  static constexpr std::size_t size = Bytes;
+
+  std::uint32_t words[Bytes / sizeof(std::uint32_t)];
+
+  std::uint32_t *base() { return words; }
+  /* Initial stack pointer, stacks are full descending */
+  std::uint32_t *top() { return words + (Bytes / sizeof(std::uint32_t)); }
+};
+
+#endif
@@ -0,0 +1,113 @@
+#include "stack.h"
+#include "memory_map.h"
+#include "mpu.h"
+
+extern std::uint32_t _estack;           /* Symbols defined in the linker script */
+extern std::uint32_t _Min_Stack_Size;
+
+static StackInfo stacks[STACK_MAX];
+
+/* The MSP entry is filled in on first use, Reset_Handler paints before .bss is cleared */
+static void stack_init_msp(){
+  if(nullptr != stacks[0].base){
+    return;
+  }
+  std::uint32_t floor = (std::uint32_t)mpu_guard_stack_floor((const void *)((std::uint32_t)&_estack - (std::uint32_t)&_Min_Stack_Size));
+  stacks[0].name = "msp";
+  stacks[0].base = (const std::uint32_t *)floor;
+  stacks[0].words = ((std::uint32_t)&_estack - floor) / sizeof(std::uint32_t);
+  stacks[0].clean_words = stacks[0].words;
+}
+
+void stack_paint(void *base, std::size_t bytes){
+  std::uint32_t *word = (std::uint32_t *)base;
+  std::uint32_t *end = word + bytes / sizeof(std::uint32_t);
+  while(word < end){
+    *word++ = STACK_PAINT;
+  }
+}
+
+void stack_paint_msp(void){
+  std::uint32_t bottom = (std::uint32_t)mpu_guard_stack_floor((const void *)((std::uint32_t)&_estack - (std::uint32_t)&_Min_Stack_Size));
+  std::uint32_t top = (__get_MSP() - STACK_PAINT_MARGIN) & ~3U;
+  if(top > bottom){
+    stack_paint((void *)bottom, top - bottom);
+  }
+}
+
+/* The MPU guard at the bottom (mpu.h) is left out, it can't be read */
+bool stack_register(const char *name, void *base, std::size_t bytes){
+  stack_init_msp();
+  std::uint32_t floor = (std::uint32_t)mpu_guard_stack_floor(base);
+  std::uint32_t top = (std::uint32_t)base + bytes;
+  if(floor >= top){
+    return false;
+  }
+  for(std::uint32_t i = 1; i < STACK_MAX; i++){
+    if(nullptr == stacks[i].base){
+      stack_paint((void *)floor, top - floor);
+      stacks[i].name = name;
+      stacks[i].words = (top - floor) / sizeof(std::uint32_t);
+      stacks[i].clean_words = stacks[i].words;
+      stacks[i].base = (const std::uint32_t *)floor;
+      return true;
+    }
+  }
+  return false;
+}
+
+void stack_unregister(const void *base){
+  const void *floor = mpu_guard_stack_floor(base);
+  for(std::uint32_t i = 1; i < STACK_MAX; i++){
+    if(floor == stacks[i].base){
+      stacks[i] = {};
+    }
+  }
+}
+
+std::uint32_t stack_capacity(void){
+  return STACK_MAX;
+}
+
+const StackInfo *stack_get(std::uint32_t index){
+  stack_init_msp();
+  return ((index < STACK_MAX) && (nullptr != stacks[index].base)) ? &stacks[index] : nullptr;
+}
+
+/* Painted words at the bottom. Stacks only grow, nothing above the last scan's clean words
+   can be clean again, so the scan stops there */
+static void stack_scan(StackInfo *stack){
+  const std::uint32_t *word = stack->base;
+  const std::uint32_t *end = stack->base + stack->clean_words;
+  while((word < end) && (STACK_PAINT == *word)){
+    word++;
+  }
+  stack->clean_words = (std::uint32_t)(word - stack->base);
+}
+
+void stack_scan_all(void){
+  stack_init_msp();
+  for(StackInfo &stack : stacks){
+    if(nullptr != stack.base){
+      stack_scan(&stack);
+    }
+  }
+}
+
+std::size_t stack_high_water(const StackInfo *stack){
+  return (std::size_t)(stack->words - stack->clean_words) * sizeof(std::uint32_t);
+}
+
+void stack_report(void){
+  printf("stack   size   used   free\n");
+  for(std::uint32_t i = 0; i < STACK_MAX; i++){
+    const StackInfo *stack = stack_get(i);
+    if(nullptr == stack){
+      continue;
+    }
+    std::size_t size = stack->words * sizeof(std::uint32_t);
+    std::size_t used = stack_high_water(stack);
+    printf("%-6s %5lu  %5lu  %5lu%s\n", stack->name, (unsigned long)size, (unsigned long)used,
+           (unsigned long)(size - used), (0 == stack->clean_words) ? "  OVERFLOW" : "");
+  }
+}
@@ -0,0 +1,66 @@
+#ifndef __STACK_H
+#define __STACK_H
+
+#include "homa_base.h"
+
+/*
+Stack high-water marks.
+
+Stacks are filled with STACK_PAINT before they're used. Stacks grow down, so the words at the
+bottom that still hold the paint were never touched, and the scanner only has to count them
+from the bottom up to the first word that changed, a plain word compare. What's above it is
+the most the stack ever used.
+
+The MSP stack (the _Min_Stack_Size reserved at the top of SRAM) is painted by Reset_Handler
+and is always stack 0. Task stacks are painted and added with stack_register. stack_scan_all
+scans them all. Nothing scans in the background, there's no periodic hook in the tree to hang
+it on: the marks are only sampled when stack_scan_all runs, which main does in BENCH builds
+before stack_report. A later scan can only find more use, never less.
+
+  static std::uint32_t blink_stack[128];
+  stack_register("blink", blink_stack, sizeof(blink_stack));
+  ...
+  stack_scan_all();
+  stack_report();
+
+Every stack has an MPU guard at the bottom (mpu.h), which isn't painted, scanned or counted in
+its size. Going past the bottom faults before the scan could see it, a stack whose bottom word
+is gone only got within a word of its guard and is reported as overflowed.
+*/
+
+#define STACK_PAINT         0xC5C5C5C5U
+#define STACK_MAX           8U        /* MSP included */
+#define STACK_PAINT_MARGIN  64U       /* bytes below the current sp left alone when painting the MSP */
+
+struct StackInfo {
+  const char *name;
+  const std::uint32_t *base;    /* lowest address above the guard */
+  std::uint32_t words;
+  std::uint32_t clean_words;    /* still painted at the bottom, as of the last scan */
+};
+
+/* Paint the reserved MSP stack below the running code, called from Reset_Handler before
+   .bss is cleared, so it touches nothing but the stack */
+void stack_paint_msp(void);
+
+/* Fill bytes at base with STACK_PAINT */
+void stack_paint(void *base, std::size_t bytes);
+
+/* Paint a task stack above its guard and track it, false if STACK_MAX stacks are tracked
+   already or the stack is no bigger than the guard */
+bool stack_register(const char *name, void *base, std::size_t bytes);
+void stack_unregister(const void *base);
+
+/* Slots stack_get takes, 0 is the MSP. Unregistering leaves holes, a free slot gives nullptr */
+std::uint32_t stack_capacity(void);
+const StackInfo *stack_get(std::uint32_t index);
+
+void stack_scan_all(void);
+
+/* Most bytes the stack ever used as of its last scan */
+std::size_t stack_high_water(const StackInfo *stack);
+
+/* Every stack's size, high-water and headroom over stdout */
+void stack_report(void);
+
+#endif
@@ -1,4 +1,11 @@
 #include "homa_base.h"
+#include "memory_map.h"
+#include "startup.h"
+#include "sections.h"
+#include "reset.h"
+#include "fault.h"
+#include "stack.h"
+#include "mpu.h"
 
 
 extern int main();
@@ -124,10 +131,17 @@ extern std::uint32_t _etext;
 extern std::uint32_t _sdata;
 extern std::uint32_t _sidata;
 extern std::uint32_t _edata;
-extern std::uint32_t _sccram;
-extern std::uint32_t _eccram;
+extern std::uint32_t _siccmram;
+extern std::uint32_t _sccmram;
+extern std::uint32_t _eccmram;
+extern std::uint32_t _sccmbss;
+extern std::uint32_t _eccmbss;
 extern std::uint32_t _sbss;
 extern std::uint32_t _ebss;
+extern std::uint8_t _sdbss;
+extern std::uint8_t _edbss;
+extern std::uint8_t _sdata_lz;
+extern std::uint8_t _edata_lz;
 
 
 std::uint32_t vectors[] __attribute__((section(".isr_vector"))) = {
@@ -239,28 +253,314 @@ std::uint32_t vectors[] __attribute__((section(".isr_vector"))) = {
   (std::uint32_t)&DMA2D_Handler           
 };
 
-void Reset_Handler(void){
+#if defined (HOMA_BENCH)
+BootBench boot_bench;
 
-  /* Copy .data section from ROM (FLASH) to RAM, copy one byte at a time */
-  std::uint32_t size = (std::uint32_t)&_edata - (std::uint32_t)&_sdata;
-  std::uint8_t *dst = (std::uint8_t*)&_sdata; // RAM
-  std::uint8_t *src = (std::uint8_t*)&_sidata; // FLASH
-  for(std::uint32_t i = 0; i < size; i++){
+/* The old one byte at a time loops, kept only so the benchmark can time them */
+static void boot_copy_bytes(std::uint8_t *dst, const std::uint8_t *src, std::uint32_t len){
+  for(std::uint32_t i = 0; i < len; i++){
     *dst++ = *src++;
   }
+}
 
-  /* Init the .bss section to 0 */
-  size = (std::uint32_t)&_ebss - (std::uint32_t)&_sbss;
-  dst = (std::uint8_t*)&_sbss;
-  for(std::uint32_t i = 0; i < size; i++){
+static void boot_zero_bytes(std::uint8_t *dst, std::uint32_t len){
+  for(std::uint32_t i = 0; i < len; i++){
     *dst++ = 0;
   }
+}
+#endif /* HOMA_BENCH */
+
+void boot_copy(void *dst, const void *src, std::uint32_t len){
+  std::uint8_t *d = (std::uint8_t*)dst;
+  const std::uint8_t *s = (const std::uint8_t*)src;
+
+  /* Bursts only work if both pointers can reach a word boundary together */
+  if((((std::uint32_t)d ^ (std::uint32_t)s) & 3U) == 0U){
+    while(((std::uint32_t)d & 3U) && len){
+      *d++ = *s++;
+      len--;
+    }
+
+    /* 16 bytes per LDM/STM pair, r3-r6 are scratch so nothing has to be stacked */
+    std::uint32_t bursts = len >> 4;
+    if(bursts){
+      asm volatile (
+        "1:                      \n"
+        "  ldmia %[s]!, {r3-r6}  \n"
+        "  stmia %[d]!, {r3-r6}  \n"
+        "  subs  %[n], %[n], #1  \n"
+        "  bne   1b              \n"
+        : [d] "+r" (d), [s] "+r" (s), [n] "+r" (bursts)
+        :
+        : "r3", "r4", "r5", "r6", "cc", "memory");
+      len &= 15U;
+    }
+
+    while(len >= 4U){
+      *(std::uint32_t*)d = *(const std::uint32_t*)s;
+      d += 4;
+      s += 4;
+      len -= 4U;
+    }
+  }
+
+  /* Unaligned tail, or the whole thing if the alignments never meet */
+  while(len--){
+    *d++ = *s++;
+  }
+}
+
+void boot_zero(void *dst, std::uint32_t len){
+  std::uint8_t *d = (std::uint8_t*)dst;
+
+  while(((std::uint32_t)d & 3U) && len){
+    *d++ = 0;
+    len--;
+  }
+
+  std::uint32_t bursts = len >> 4;
+  if(bursts){
+    asm volatile (
+      "  movs  r3, #0            \n"
+      "  movs  r4, #0            \n"
+      "  movs  r5, #0            \n"
+      "  movs  r6, #0            \n"
+      "1:                        \n"
+      "  stmia %[d]!, {r3-r6}    \n"
+      "  subs  %[n], %[n], #1    \n"
+      "  bne   1b                \n"
+      : [d] "+r" (d), [n] "+r" (bursts)
+      :
+      : "r3", "r4", "r5", "r6", "cc", "memory");
+    len &= 15U;
+  }
+
+  while(len >= 4U){
+    *(std::uint32_t*)d = 0;
+    d += 4;
+    len -= 4U;
+  }
+
+  while(len--){
+    *d++ = 0;
+  }
+}
+
+/* Next byte of .bss_deferred to clear, nullptr until the first step. Lives in the regular
+   .bss so it's valid as soon as Reset_Handler is done */
+static std::uint8_t *deferred_cursor;
+
+bool boot_deferred_zero_step(std::uint32_t max_bytes){
+  if(nullptr == deferred_cursor){
+    deferred_cursor = &_sdbss;
+  }
+
+  std::uint32_t left = (std::uint32_t)&_edbss - (std::uint32_t)deferred_cursor;
+  if(max_bytes > left){
+    max_bytes = left;
+  }
+
+  boot_zero(deferred_cursor, max_bytes);
+  deferred_cursor += max_bytes;
+
+  return deferred_cursor == &_edbss;
+}
+
+void boot_deferred_zero_finish(void){
+  boot_deferred_zero_step(0xFFFFFFFFU);
+}
+
+bool boot_deferred_zero_done(void){
+  return (deferred_cursor == &_edbss) || (&_sdbss == &_edbss);
+}
+
+HOMA_NOINIT BootRecord boot_record;
+
+static std::uint32_t boot_record_sum(){
+  const std::uint32_t *word = (const std::uint32_t*)&boot_record;
+  std::uint32_t sum = 0;
+
+  for(std::uint32_t i = 0; i < offsetof(BootRecord, checksum) / sizeof(std::uint32_t); i++){
+    sum = ((sum << 1) | (sum >> 31)) ^ word[i];
+  }
+  return sum;
+}
+
+/* Keep last boot's stamps if the record is intact, start over otherwise (power on) */
+static void boot_record_begin(){
+  if((BOOT_RECORD_MAGIC == boot_record.magic) && (boot_record_sum() == boot_record.checksum)){
+    for(std::uint32_t i = 0; i < BOOT_PHASE_COUNT; i++){
+      boot_record.prev_stamp[i] = boot_record.stamp[i];
+      boot_record.stamp[i] = 0;
+    }
+    boot_record.boot_count++;
+  }
+  else{
+    boot_zero(&boot_record, sizeof(boot_record));
+    boot_record.magic = BOOT_RECORD_MAGIC;
+    boot_record.boot_count = 1;
+  }
+  boot_record.reset_cause = reset_cause();
+  boot_record.warm = reset_is_warm();
+  boot_record.checksum = boot_record_sum();
+}
+
+void boot_record_mark(BootPhase phase){
+  boot_record.stamp[phase] = DWT_GetCycleCount();
+  boot_record.checksum = boot_record_sum();
+}
+
+void boot_record_dump(void){
+  static const char *const names[BOOT_PHASE_COUNT] = {"data", "bss", "libc", "pll", "sysinit", "main"};
+  std::uint32_t last = 0, prev_last = 0;
+
+  printf("boot #%lu, %s reset%s, cycles per phase (previous boot)\n", (unsigned long)boot_record.boot_count,
+         reset_cause_name((ResetCause)boot_record.reset_cause), boot_record.warm ? " (warm)" : "");
+
+  for(std::uint32_t i = 0; i < BOOT_PHASE_COUNT; i++){
+    /* Phases that weren't marked are 0 */
+    if(0 == boot_record.stamp[i]){
+      printf("  %-8s          -\n", names[i]);
+      continue;
+    }
+
+    std::uint32_t now = boot_record.stamp[i] - last;
+    std::uint32_t prev = 0;
+    if(0 != boot_record.prev_stamp[i]){
+      prev = boot_record.prev_stamp[i] - prev_last;
+      prev_last = boot_record.prev_stamp[i];
+    }
+    last = boot_record.stamp[i];
+
+    printf("  %-8s %10lu (%10lu)%s\n", names[i], (unsigned long)now, (unsigned long)prev,
+           (prev && (now > prev + (prev >> 3))) ? " slower" : "");
+  }
+}
+
+/* Unpack the .data_lz blob written by rle_pack (see rle_pack.cpp for the format).
+   Each record is dst, raw size, packed size, then the packed stream padded to 4 bytes */
+static void boot_unpack(const std::uint8_t *src, const std::uint8_t *end){
+  while(src < end){
+    const std::uint32_t *hdr = (const std::uint32_t*)src;
+    std::uint8_t *dst = (std::uint8_t*)hdr[0];
+    const std::uint8_t *in = src + 12;
+    const std::uint8_t *in_end = in + hdr[2];
+
+    while(in < in_end){
+      std::uint32_t ctrl = *in++;
+      if(ctrl & 0x80U){
+        /* run, one byte repeated (ctrl & 0x7F) + 3 times */
+        std::uint32_t n = (ctrl & 0x7FU) + 3U;
+        std::uint8_t value = *in++;
+        while(n--){
+          *dst++ = value;
+        }
+      }
+      else{
+        /* literal, ctrl + 1 bytes */
+        std::uint32_t n = ctrl + 1U;
+        while(n--){
+          *dst++ = *in++;
+        }
+      }
+    }
+
+    src = in_end + ((4U - (hdr[2] & 3U)) & 3U);
+  }
+}
+
+/* Fill .data and .ccmram. When the image was built with make final_lz.elf the load images
+   are not in flash as is, only the packed .data_lz blob is */
+static void boot_load_images(){
+  if(&_sdata_lz != &_edata_lz){
+    boot_unpack(&_sdata_lz, &_edata_lz);
+  }
+  else{
+    boot_copy(&_sdata, &_sidata, (std::uint32_t)&_edata - (std::uint32_t)&_sdata);
+    boot_copy(&_sccmram, &_siccmram, (std::uint32_t)&_eccmram - (std::uint32_t)&_sccmram);
+  }
+}
+
+/* Zero .bss and .ccmbss, .bss_deferred is left for later */
+static void boot_zero_sections(){
+  boot_zero(&_sbss, (std::uint32_t)&_ebss - (std::uint32_t)&_sbss);
+  boot_zero(&_sccmbss, (std::uint32_t)&_eccmbss - (std::uint32_t)&_sccmbss);
+}
+
+void Reset_Handler(void){
+
+  /* Start timing first thing, everything below is stamped into the boot record */
+  DWT_EnableCycleCounter();
+  reset_capture();
+  boot_record_begin();
+  fault_init();
+  stack_paint_msp();
+  mpu_guard_init();
+
+  /* CCM clock is on out of reset, make sure nothing before us turned it off */
+  RCC->AHB1ENR |= RCC_AHB1ENR_CCMDATARAMEN;
+
+#if defined (HOMA_BENCH)
+  /* Results can only be stored once .bss is cleared, keep them in locals until then.
+     The byte loops also end up in the boot record's data and bss phases */
+  std::uint32_t data_size = (std::uint32_t)&_edata - (std::uint32_t)&_sdata;
+  std::uint32_t bss_size = (std::uint32_t)&_ebss - (std::uint32_t)&_sbss;
+  std::uint32_t t_data_byte, t_data_init, t_bss_byte, t_bss_burst, t;
+
+  t = DWT_GetCycleCount();
+  boot_copy_bytes((std::uint8_t*)&_sdata, (std::uint8_t*)&_sidata, data_size);
+  t_data_byte = DWT_GetCycleCount() - t;
+
+  t = DWT_GetCycleCount();
+  boot_load_images();
+  t_data_init = DWT_GetCycleCount() - t;
+  boot_record_mark(BOOT_PHASE_DATA);
+
+  t = DWT_GetCycleCount();
+  boot_zero_bytes((std::uint8_t*)&_sbss, bss_size);
+  t_bss_byte = DWT_GetCycleCount() - t;
+
+  t = DWT_GetCycleCount();
+  boot_zero_sections();
+  t_bss_burst = DWT_GetCycleCount() - t;
+  boot_record_mark(BOOT_PHASE_BSS);
+
+  boot_bench.data_copy_byte = t_data_byte;
+  boot_bench.data_init = t_data_init;
+  boot_bench.data_packed = (&_sdata_lz != &_edata_lz);
+  boot_bench.bss_zero_byte = t_bss_byte;
+  boot_bench.bss_zero_burst = t_bss_burst;
+
+  t = DWT_GetCycleCount();
+  __libc_init_array();
+  boot_bench.libc_init = DWT_GetCycleCount() - t;
+  boot_record_mark(BOOT_PHASE_LIBC);
+
+  t = DWT_GetCycleCount();
+  SystemInit();
+  boot_bench.system_init = DWT_GetCycleCount() - t;
+  boot_record_mark(BOOT_PHASE_SYSINIT);
+
+  boot_bench.reset_to_main = DWT_GetCycleCount() - t_data_byte - t_bss_byte;
+#else
+  /* Copy .data and .ccmram from ROM (FLASH) to RAM */
+  boot_load_images();
+  boot_record_mark(BOOT_PHASE_DATA);
+
+  /* Init the .bss sections to 0 */
+  boot_zero_sections();
+  boot_record_mark(BOOT_PHASE_BSS);
 
   /* Init stuff for standard lib */
   __libc_init_array();
+  boot_record_mark(BOOT_PHASE_LIBC);
 
   SystemInit();
+  boot_record_mark(BOOT_PHASE_SYSINIT);
+#endif /* HOMA_BENCH */
+
   /* Call main */
+  boot_record_mark(BOOT_PHASE_MAIN);
   main();
 
   /* Fini stuff for standard lib */
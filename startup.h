@@ -0,0 +1,90 @@
+#ifndef __STARTUP_H
+#define __STARTUP_H
+
+#include "homa_base.h"
+
+/*
+Helpers used by Reset_Handler to set up RAM before main. They are exported
+so that other code that has to move or clear large blocks of memory early on
+(before the standard library is usable) can share them.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Copy len bytes from src to dst. When src and dst share the same word alignment the
+   bulk is moved with 4 word LDM/STM bursts, the head and tail are copied byte by byte */
+void boot_copy(void *dst, const void *src, std::uint32_t len);
+
+/* Zero len bytes starting at dst, the bulk is cleared with 4 word STM bursts */
+void boot_zero(void *dst, std::uint32_t len);
+
+/* Deferred .bss (HOMA_DEFERRED_BSS in sections.h). Reset_Handler only clears the regular .bss,
+   the deferred section is cleared by these, in order, from a single context (idle task or
+   the first user). Step clears at most max_bytes and returns true once everything is zero */
+bool boot_deferred_zero_step(std::uint32_t max_bytes);
+void boot_deferred_zero_finish(void);
+bool boot_deferred_zero_done(void);
+
+/*
+Boot record, kept in .noinit so it survives a reset. Each boot Reset_Handler starts the DWT
+cycle counter first thing and marks the end of every phase with the counter value, so
+stamp[phase] is cycles since reset. The previous boot's stamps are kept next to it, so
+a boot that got slower is easy to spot in boot_record_dump. Cycles are core cycles, the
+clock changes from 16 MHz HSI to the PLL during BOOT_PHASE_PLL.
+*/
+enum BootPhase {
+  BOOT_PHASE_DATA,      /* .data/.ccmram init done */
+  BOOT_PHASE_BSS,       /* .bss/.ccmbss zeroed */
+  BOOT_PHASE_LIBC,      /* __libc_init_array done */
+  BOOT_PHASE_PLL,       /* clock tree up, marked from SystemInit */
+  BOOT_PHASE_SYSINIT,   /* SystemInit returned */
+  BOOT_PHASE_MAIN,      /* entering main */
+  BOOT_PHASE_COUNT
+};
+
+#define BOOT_RECORD_MAGIC   0xB007C0DEU
+
+struct BootRecord {
+  std::uint32_t magic;
+  std::uint32_t boot_count;
+  std::uint32_t reset_cause;  /* ResetCause, see reset.h */
+  std::uint32_t warm;         /* 1 if it took the warm reset path */
+  std::uint32_t stamp[BOOT_PHASE_COUNT];
+  std::uint32_t prev_stamp[BOOT_PHASE_COUNT];
+  std::uint32_t checksum;   /* over everything above, to reject a half written record */
+};
+
+extern BootRecord boot_record;
+
+/* Store the cycle counter as the end of phase */
+void boot_record_mark(BootPhase phase);
+
+/* Print the current and previous boot per phase over stdout, flagging phases that got
+   more than 1/8 slower */
+void boot_record_dump(void);
+
+#if defined (HOMA_BENCH)
+/* Cycles spent in each phase of Reset_Handler. The byte entries time the old one byte
+   at a time loops over the same region so the two can be compared on the same image */
+struct BootBench {
+  std::uint32_t data_copy_byte;  /* .data only */
+  std::uint32_t data_init;       /* .data + .ccmram, burst copy or unpacking .data_lz */
+  std::uint32_t data_packed;     /* 1 if data_init unpacked .data_lz */
+  std::uint32_t bss_zero_byte;   /* .bss only */
+  std::uint32_t bss_zero_burst;  /* .bss + .ccmbss */
+  std::uint32_t libc_init;
+  std::uint32_t system_init;
+  std::uint32_t reset_to_main;   /* without the byte loop runs above */
+  std::uint32_t deferred_zero;   /* work moved out of boot by .bss_deferred, set by bench.cpp */
+};
+
+extern BootBench boot_bench;
+#endif /* HOMA_BENCH */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
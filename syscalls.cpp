@@ -2,6 +2,8 @@
 
 /* Includes */
 #include "homa_base.h"
+#include "console.h"
+#include "itm.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -53,16 +55,16 @@ __attribute__((weak)) int _read(int file, char *ptr, int len)
   return len;
 }
 
+/* Descriptors mapped to an ITM port go there (itm.h), the rest to the UART console */
 __attribute__((weak)) int _write(int file, char *ptr, int len)
 {
-  (void)file;
-  int DataIdx;
+  int port = itm_fd_port(file);
 
-  for (DataIdx = 0; DataIdx < len; DataIdx++)
+  if (port >= 0)
   {
-    __io_putchar(*ptr++);
+    return (int)itm_write((std::uint32_t)port, ptr, (std::size_t)len);
   }
-  return len;
+  return (int)console_write(ptr, (std::size_t)len);
 }
 
 int _close(int file)
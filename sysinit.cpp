@@ -5,6 +5,10 @@
   
 
 #include "memory_map.h"
+#include "startup.h"
+#include "reset.h"
+#include "clock.h"
+#include "sdram.h"
 
 
 
@@ -24,14 +28,22 @@ void SystemCoreClockUpdate();
   */
 
 /************************* Miscellaneous Configuration ************************/
-/*!< Uncomment the following line if you need to use external SDRAM mounted
-     on the EVAL as data memory  */
+/*!< Define DATA_IN_ExtSDRAM (make SDRAM=1) to bring up the 8M SDRAM on the Discovery
+     board at 0xD0000000 (FMC bank 2), used by .sdram and MEM_REGION_SDRAM (sysmem.h).
+     The timings assume the 180 MHz clock SystemClock_Config sets up just before */
 /* #define DATA_IN_ExtSDRAM */ 
 
-/*!< Uncomment the following line if you need to relocate your vector Table in
-     Internal SRAM. */
+/*!< Define VECT_TAB_SRAM (make VECTORS=sram) to copy the vector table to the
+     _sram_vectors block reserved by the linker script and run from there. The RAM
+     table can then be changed at runtime with NVIC_SetVector. */
 /* #define VECT_TAB_SRAM */
 #define VECT_TAB_OFFSET  0x00 /*!< Vector Table base offset field. This value must be a multiple of 0x200. */
+
+#ifdef VECT_TAB_SRAM
+extern std::uint32_t _svectors;       /* Symbols defined in the linker script */
+extern std::uint32_t _evectors;
+extern std::uint32_t _sram_vectors;
+#endif /* VECT_TAB_SRAM */
 /******************************************************************************/
 
 /**
@@ -96,23 +108,32 @@ void SystemInit()
     SCB->CPACR |= ((3UL << 10*2)|(3UL << 11*2));  /* set CP10 and CP11 Full Access */
   #endif
   /* Reset the RCC clock configuration to the default reset state ------------*/
-  /* Set HSION bit */
-  RCC->CR |= (uint32_t)0x00000001;
+  /* A software or watchdog reset has just done that in hardware, only a cold boot
+     (or a jump from a bootloader, which looks like one) needs it */
+  if(!reset_is_warm())
+  {
+    /* Set HSION bit */
+    RCC->CR |= (uint32_t)0x00000001;
 
-  /* Reset CFGR register */
-  RCC->CFGR = 0x00000000;
+    /* Reset CFGR register */
+    RCC->CFGR = 0x00000000;
 
-  /* Reset HSEON, CSSON and PLLON bits */
-  RCC->CR &= (uint32_t)0xFEF6FFFF;
+    /* Reset HSEON, CSSON and PLLON bits */
+    RCC->CR &= (uint32_t)0xFEF6FFFF;
 
-  /* Reset PLLCFGR register */
-  RCC->PLLCFGR = 0x24003010;
+    /* Reset PLLCFGR register */
+    RCC->PLLCFGR = 0x24003010;
 
-  /* Reset HSEBYP bit */
-  RCC->CR &= (uint32_t)0xFFFBFFFF;
+    /* Reset HSEBYP bit */
+    RCC->CR &= (uint32_t)0xFFFBFFFF;
 
-  /* Disable all interrupts */
-  RCC->CIR = 0x00000000;
+    /* Disable all interrupts */
+    RCC->CIR = 0x00000000;
+  }
+
+  /* HSE + PLL to 180 MHz, see clock.h. Everything after this runs at full speed */
+  SystemClock_Config();
+  boot_record_mark(BOOT_PHASE_PLL);
 
 #if defined (DATA_IN_ExtSDRAM)
   SystemInit_ExtMemCtl(); 
@@ -120,7 +141,12 @@ void SystemInit()
 
   /* Configure the Vector Table location add offset address ------------------*/
 #ifdef VECT_TAB_SRAM
-  SCB->VTOR = SRAM_BASE | VECT_TAB_OFFSET; /* Vector Table Relocation in Internal SRAM */
+  /* Copy the flash table into the aligned RAM block, then switch over */
+  boot_copy(&_sram_vectors, &_svectors, (uint32_t)&_evectors - (uint32_t)&_svectors);
+  __DSB();
+  SCB->VTOR = (uint32_t)&_sram_vectors; /* Vector Table Relocation in Internal SRAM */
+  __DSB();
+  __ISB();
 #else
   SCB->VTOR = FLASH_BASE | VECT_TAB_OFFSET; /* Vector Table Relocation in Internal FLASH */
 #endif
@@ -221,139 +247,10 @@ void SystemCoreClockUpdate()
   */
 void SystemInit_ExtMemCtl(void)
 {
-  register uint32_t tmpreg = 0, timeout = 0xFFFF;
-  register __IO uint32_t index;
-
-  /* Enable GPIOA, GPIOC, GPIOD, GPIOE, GPIOF and GPIOG interface 
-  clock */
-  RCC->AHB1ENR |= 0x0000007D;
-
-  /* Connect PAx pins to FMC Alternate function */
-  GPIOA->AFR[0]  = 0xC0000000;
-  GPIOA->AFR[1]  = 0x00000000;
-  /* Configure PAx pins in Alternate function mode */ 
-  GPIOA->MODER   = 0xA8008000;
-  /* Configure PAx pins speed to 100 MHz */
-  GPIOA->OSPEEDR = 0x0C00C000;
-  /* Configure PAx pins Output type to push-pull */
-  GPIOA->OTYPER  = 0x00000000;
-  /* No pull-up, pull-down for PAx pins */ 
-  GPIOA->PUPDR   = 0x64000000;
-
-  /* Connect PCx pins to FMC Alternate function */
-  GPIOC->AFR[0]  = 0x00CC0000;
-  GPIOC->AFR[1]  = 0x00000000;
-  /* Configure PCx pins in Alternate function mode */ 
-  GPIOC->MODER   = 0x00000A00;
-  /* Configure PCx pins speed to 100 MHz */
-  GPIOC->OSPEEDR = 0x00000F00;
-  /* Configure PCx pins Output type to push-pull */
-  GPIOC->OTYPER  = 0x00000000;
-  /* No pull-up, pull-down for PCx pins */ 
-  GPIOC->PUPDR   = 0x00000000;
-
-  /* Connect PDx pins to FMC Alternate function */
-  GPIOD->AFR[0]  = 0x000000CC;
-  GPIOD->AFR[1]  = 0xCC000CCC;
-  /* Configure PDx pins in Alternate function mode */ 
-  GPIOD->MODER   = 0xA02A000A;
-  /* Configure PDx pins speed to 100 MHz */
-  GPIOD->OSPEEDR = 0xF03F000F;
-  /* Configure PDx pins Output type to push-pull */
-  GPIOD->OTYPER  = 0x00000000;
-  /* No pull-up, pull-down for PDx pins */ 
-  GPIOD->PUPDR   = 0x00000000;
-
-  /* Connect PEx pins to FMC Alternate function */
-  GPIOE->AFR[0]  = 0xC00000CC;
-  GPIOE->AFR[1]  = 0xCCCCCCCC;
-  /* Configure PEx pins in Alternate function mode */ 
-  GPIOE->MODER   = 0xAAAA800A;
-  /* Configure PEx pins speed to 100 MHz */
-  GPIOE->OSPEEDR = 0xFFFFC00F;
-  /* Configure PEx pins Output type to push-pull */
-  GPIOE->OTYPER  = 0x00000000;
-  /* No pull-up, pull-down for PEx pins */ 
-  GPIOE->PUPDR   = 0x00000000;
-  
-  /* Connect PFx pins to FMC Alternate function */
-  GPIOF->AFR[0]  = 0x00CCCCCC;
-  GPIOF->AFR[1]  = 0xCCCCC000;
-  /* Configure PFx pins in Alternate function mode */ 
-  GPIOF->MODER   = 0xAA800AAA;
-  /* Configure PFx pins speed to 100 MHz */
-  GPIOF->OSPEEDR = 0xFFC00FFF;
-  /* Configure PFx pins Output type to push-pull */
-  GPIOF->OTYPER  = 0x00000000;
-  /* No pull-up, pull-down for PFx pins */ 
-  GPIOF->PUPDR   = 0x00000000;
-  
-  /* Connect PGx pins to FMC Alternate function */
-  GPIOG->AFR[0]  = 0x00CC0CCC;
-  GPIOG->AFR[1]  = 0xC000000C;
-  /* Configure PGx pins in Alternate function mode */ 
-  GPIOG->MODER   = 0x80020A2A;
-  /* Configure PGx pins speed to 100 MHz */
-  GPIOG->OSPEEDR = 0xC0030F3F;
-  /* Configure PGx pins Output type to push-pull */
-  GPIOG->OTYPER  = 0x00000000;
-  /* No pull-up, pull-down for PGx pins */ 
-  GPIOG->PUPDR   = 0x00000000;
-
-  /* FMC Configuration */
-  /* Enable the FMC interface clock */
-  RCC->AHB3ENR |= 0x00000001;
-  
-  /* Configure and enable SDRAM bank2 */
-  FMC_Bank5_6->SDCR[0] = 0x00001954;
-  FMC_Bank5_6->SDTR[0] = 0x01115351;
-  
-  /* SDRAM initialization sequence */
-  /* Clock enable command */
-  FMC_Bank5_6->SDCMR = 0x00000011; 
-  tmpreg = FMC_Bank5_6->SDSR & 0x00000020; 
-  while((tmpreg != 0) && (timeout-- > 0))
-  {
-    tmpreg = FMC_Bank5_6->SDSR & 0x00000020; 
-  }
-
-  /* Delay */
-  for (index = 0; index<1000; index++);
-  
-  /* PALL command */
-  FMC_Bank5_6->SDCMR = 0x00000012;     
-  tmpreg = FMC_Bank5_6->SDSR & 0x00000020;
-  timeout = 0xFFFF;
-  while((tmpreg != 0) && (timeout-- > 0))
-  {
-    tmpreg = FMC_Bank5_6->SDSR & 0x00000020; 
-  }
-  
-  /* Auto refresh command */
-  FMC_Bank5_6->SDCMR = 0x000000F3;
-  tmpreg = FMC_Bank5_6->SDSR & 0x00000020;
-  timeout = 0xFFFF;
-  while((tmpreg != 0) && (timeout-- > 0))
-  {
-    tmpreg = FMC_Bank5_6->SDSR & 0x00000020; 
-  }
- 
-  /* MRD register program */
-  FMC_Bank5_6->SDCMR = 0x00044014;
-  tmpreg = FMC_Bank5_6->SDSR & 0x00000020;
-  timeout = 0xFFFF;
-  while((tmpreg != 0) && (timeout-- > 0))
-  {
-    tmpreg = FMC_Bank5_6->SDSR & 0x00000020; 
-  } 
-  
-  /* Set refresh count */
-  tmpreg = FMC_Bank5_6->SDRTR;
-  FMC_Bank5_6->SDRTR = (tmpreg | (0x0000056A<<1));
-  
-  /* Disable write protection */
-  tmpreg = FMC_Bank5_6->SDCR[0]; 
-  FMC_Bank5_6->SDCR[0] = (tmpreg & 0xFFFFFDFF);
+  /* Pins, FMC timings and the command sequence are tables in sdram.cpp. If it fails the
+     SDRAM region stays empty and HOMA_SDRAM data must not be touched, see sdram_ready().
+     There's no console yet, main reports the outcome with sdram_report() */
+  (void)sdram_init();
 }
 #endif /* DATA_IN_ExtSDRAM */
 
@@ -0,0 +1,56 @@
+#include "syslock.h"
+#include "memory_map.h"
+
+/* Only touched with BASEPRI raised, so no interrupt that could lock sees them half done */
+static std::uint32_t lock_depth;
+static std::uint32_t lock_saved_basepri;
+
+static void syslock_enter(){
+  std::uint32_t prev = __get_BASEPRI();
+  __set_BASEPRI_MAX(SYSLOCK_BASEPRI);
+  if(0 == lock_depth++){
+    lock_saved_basepri = prev;
+  }
+}
+
+static void syslock_leave(){
+  if(0 == --lock_depth){
+    __set_BASEPRI(lock_saved_basepri);
+  }
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void __malloc_lock(struct _reent *reent){
+  (void)reent;
+  syslock_enter();
+}
+
+void __malloc_unlock(struct _reent *reent){
+  (void)reent;
+  syslock_leave();
+}
+
+void __env_lock(struct _reent *reent){
+  (void)reent;
+  syslock_enter();
+}
+
+void __env_unlock(struct _reent *reent){
+  (void)reent;
+  syslock_leave();
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+void syslock_reent_init(struct _reent *reent){
+  _REENT_INIT_PTR(reent);
+}
+
+std::uint32_t syslock_depth(void){
+  return lock_depth;
+}
@@ -0,0 +1,56 @@
+#ifndef __SYSLOCK_H
+#define __SYSLOCK_H
+
+#include "homa_base.h"
+#include <sys/reent.h>
+
+/*
+newlib's hooks for running under a scheduler.
+
+Locks. newlib brackets malloc (and heap.cpp brackets every heap call) with __malloc_lock /
+__malloc_unlock, and getenv/setenv with __env_lock / __env_unlock. All of them are a
+recursive BASEPRI critical section here: the outermost lock raises BASEPRI to
+SYSLOCK_PRIORITY with __set_BASEPRI_MAX (never lowering a higher mask that's already set)
+and the matching outermost unlock puts back what was there. Interrupts more urgent than
+SYSLOCK_PRIORITY (numerically lower) keep running and must not touch the heap, everything at
+SYSLOCK_PRIORITY or below, the scheduler's PendSV included, waits for the few hundred cycles
+a heap call takes. stdio's FILE locks stay newlib's no-ops, a BASEPRI section around a whole
+printf would be far too long.
+
+Reentrancy. newlib keeps errno, strtok's state, the stdio stream pointers and the like in a
+struct _reent found through _impure_ptr. Every task gets its own, set up with
+syslock_reent_init, and the context switch points _impure_ptr at the next task's with
+syslock_reent_switch, one store.
+
+  struct Task { ...; struct _reent reent; };
+  syslock_reent_init(&task->reent);                 // task creation
+  syslock_reent_switch(&next->reent);               // PendSV, before switching stacks
+*/
+
+#define SYSLOCK_PRIORITY   5U     /* NVIC priority, 0 (most urgent) to 15 */
+#define SYSLOCK_BASEPRI    (SYSLOCK_PRIORITY << (8U - __NVIC_PRIO_BITS))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void __malloc_lock(struct _reent *reent);
+void __malloc_unlock(struct _reent *reent);
+void __env_lock(struct _reent *reent);
+void __env_unlock(struct _reent *reent);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* Fresh reentrancy state, stdin/stdout/stderr as in the startup one */
+void syslock_reent_init(struct _reent *reent);
+
+inline void syslock_reent_switch(struct _reent *next){
+  _impure_ptr = next;
+}
+
+/* Current lock nesting, 0 outside any lock */
+std::uint32_t syslock_depth(void);
+
+#endif
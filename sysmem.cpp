@@ -1,7 +1,10 @@
 #include "homa_base.h"
+#include "sysmem.h"
+#include "sdram.h"
 
-/* 
-This function is taken from here: https://github.com/STMicroelectronics/STM32CubeF4/blob/master/Projects/STM32F429ZI-Nucleo/Examples/BSP/STM32CubeIDE/Example/User/sysmem.c
+/*
+_sbrk is taken from here: https://github.com/STMicroelectronics/STM32CubeF4/blob/master/Projects/STM32F429ZI-Nucleo/Examples/BSP/STM32CubeIDE/Example/User/sysmem.c
+and generalized to the regions in sysmem.h
 
  * ############################################################################
  * #  .data  #  .bss  #       newlib heap       #          MSP stack          #
@@ -9,44 +12,121 @@ This function is taken from here: https://github.com/STMicroelectronics/STM32Cub
  * ############################################################################
  * ^-- RAM start      ^-- _end                             _estack, RAM end --^
 
-dynamic memory is allocated starting from the end of the _end linker symbol
+dynamic memory is allocated starting from the end of the _end linker symbol, the CCM
+and SDRAM regions work the same from _eccmbss and _esdram up to the end of their memory
 
 */
 
-#ifdef __cplusplus
-extern "C" {
-#endif
+extern std::uint8_t _end;             /* Symbols defined in the linker script */
+extern std::uint8_t _estack;
+extern std::uint32_t _Min_Stack_Size;
+extern std::uint8_t _eccmbss;
+extern std::uint8_t _eccm;
+extern std::uint8_t _esdram;
+extern std::uint8_t _esdram_mem;
 
+struct MemRegionBreak {
+  std::uint8_t *brk;      /* nullptr until the first call */
+  std::uint8_t *limit;
+};
 
-static std::uint8_t *__sbrk_heap_end = nullptr;
+static MemRegionBreak region_breaks[MEM_REGION_COUNT];
 
-void* _sbrk(std::ptrdiff_t incr) {
-  extern std::uint8_t _end; /* Symbol defined in the linker script */
-  extern std::uint8_t _estack; /* Symbol defined in the linker script */
-  extern std::uint32_t _Min_Stack_Size; /* Symbol defined in the linker script */
-  const std::uint32_t stack_limit = (uint32_t)&_estack - (uint32_t)&_Min_Stack_Size;
-  const std::uint8_t *max_heap = (uint8_t *)stack_limit;
-  std::uint8_t *prev_heap_end;
+static void region_init(MemRegion region){
+  MemRegionBreak &r = region_breaks[region];
+
+  switch(region){
+    case MEM_REGION_SRAM:
+      r.brk = &_end;
+      /* Protect heap from growing into the reserved MSP stack */
+      r.limit = (std::uint8_t *)((std::uint32_t)&_estack - (std::uint32_t)&_Min_Stack_Size);
+      break;
+    case MEM_REGION_CCM:
+      r.brk = &_eccmbss;
+      r.limit = &_eccm;
+      break;
+    case MEM_REGION_SDRAM:
+      r.brk = &_esdram;
+      /* Nothing to hand out if the SDRAM isn't set up or failed its test */
+      r.limit = sdram_ready() ? &_esdram_mem : &_esdram;
+      break;
+    default:
+      r.brk = nullptr;
+      r.limit = nullptr;
+      break;
+  }
+}
+
+void *region_sbrk(MemRegion region, std::ptrdiff_t incr){
+  if(region >= MEM_REGION_COUNT){
+    errno = ENOMEM;
+    return (void *)-1;
+  }
+
+  MemRegionBreak &r = region_breaks[region];
 
   /* Initialize heap end at first call */
-  if (nullptr == __sbrk_heap_end)
-  {
-    __sbrk_heap_end = &_end;
+  if(nullptr == r.brk){
+    region_init(region);
   }
 
-  /* Protect heap from growing into the reserved MSP stack */
-  if (__sbrk_heap_end + incr > max_heap)
-  {
+  /* A call before SystemInit's sdram_init found the SDRAM down, open it up once it's ready */
+  if((MEM_REGION_SDRAM == region) && (&_esdram == r.limit) && sdram_ready()){
+    r.limit = &_esdram_mem;
+  }
+
+  if(r.brk + incr > r.limit){
     errno = ENOMEM;
     return (void *)-1;
   }
 
-  prev_heap_end = __sbrk_heap_end;
-  __sbrk_heap_end += incr;
+  std::uint8_t *prev = r.brk;
+  r.brk += incr;
+
+  return (void *)prev;
+}
+
+void *region_alloc(MemRegion region, std::size_t size, std::size_t align){
+  /* Pad the break up to align first, then take size */
+  std::uint8_t *brk = (std::uint8_t *)region_sbrk(region, 0);
+  if((void *)-1 == brk){
+    return nullptr;
+  }
+
+  std::size_t pad = (align - ((std::uint32_t)brk & (align - 1))) & (align - 1);
+  if(region_free(region) < pad + size){
+    return nullptr;
+  }
+
+  region_sbrk(region, (std::ptrdiff_t)pad);
+  return region_sbrk(region, (std::ptrdiff_t)size);
+}
+
+std::size_t region_free(MemRegion region){
+  if((region >= MEM_REGION_COUNT) || ((void *)-1 == region_sbrk(region, 0))){
+    return 0;
+  }
+  return (std::size_t)(region_breaks[region].limit - region_breaks[region].brk);
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
-  return (void *)prev_heap_end;
+#if !defined (HOMA_NO_HEAP)
+void* _sbrk(std::ptrdiff_t incr) {
+  return region_sbrk(MEM_REGION_SRAM, incr);
 }
+#else
+/* Never defined, only a link error if newlib's malloc is kept, see new_delete.h */
+void HOMA_NO_HEAP_heap_reached(void);
 
+void* _sbrk(std::ptrdiff_t incr) {
+  (void)incr;
+  HOMA_NO_HEAP_heap_reached();
+  return (void *)-1;
+}
+#endif /* !HOMA_NO_HEAP */
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,39 @@
+#ifndef __SYSMEM_H
+#define __SYSMEM_H
+
+#include "homa_base.h"
+
+/*
+Memory regions that can grow a heap. Each one is a [start, limit) range given by the linker
+script with its own break, moved by region_sbrk the same way _sbrk moves the newlib one
+(which is region_sbrk(MEM_REGION_SRAM, incr)).
+
+  MEM_REGION_SRAM   after ._user_heap_stack's start (_end) up to the reserved MSP stack
+  MEM_REGION_CCM    after .ccmbss up to the end of CCM. CPU only, no DMA buffers in here
+  MEM_REGION_SDRAM  after .sdram up to the end of the 8M SDRAM. Only there when SDRAM is
+                    brought up (make SDRAM=1) and passed its test, empty otherwise
+
+Memory handed out by region_alloc is never given back, it's for buffers that live as long
+as the program (frame buffers, sample buffers, pools).
+
+  std::uint16_t *frame = (std::uint16_t *)region_alloc(MEM_REGION_SDRAM, 240 * 320 * 2, 32);
+*/
+
+enum MemRegion {
+  MEM_REGION_SRAM,
+  MEM_REGION_CCM,
+  MEM_REGION_SDRAM,
+  MEM_REGION_COUNT
+};
+
+/* Move the break of region by incr bytes and return the old break, (void *)-1 with errno set
+   to ENOMEM if that goes past the region's limit */
+void *region_sbrk(MemRegion region, std::ptrdiff_t incr);
+
+/* size bytes aligned to align (a power of 2) out of region, nullptr if it doesn't fit */
+void *region_alloc(MemRegion region, std::size_t size, std::size_t align);
+
+/* Bytes between the region's break and its limit */
+std::size_t region_free(MemRegion region);
+
+#endif
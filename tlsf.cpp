@@ -0,0 +1,393 @@
+#include "tlsf.h"
+#include <cstring>
+
+/*
+Block layout. prev_phys and size are the header, the free list links overlap the payload
+and only mean something while the block is free. The size is a multiple of TLSF_ALIGN, the
+low bit says the block is free. Every pool ends in a used block of size 0 so the last real
+block has a next to look at.
+
+  | prev_phys | size |F| payload ...                   | prev_phys | size |F| ...
+  ^-- TlsfBlock       ^-- pointer handed out            ^-- block_next()
+*/
+struct TlsfBlock {
+  TlsfBlock *prev_phys;     /* physically before this one, nullptr for the first in a pool */
+  std::size_t size;
+  TlsfBlock *next_free;
+  TlsfBlock *prev_free;
+};
+
+#define TLSF_FREE   1U
+
+static_assert(TLSF_HEADER == offsetof(TlsfBlock, next_free), "TLSF_HEADER doesn't match TlsfBlock");
+static_assert(TLSF_BLOCK_MIN >= sizeof(TlsfBlock) - TLSF_HEADER, "free list links don't fit the smallest block");
+static_assert((TLSF_HEADER % TLSF_ALIGN) == 0, "headers would misalign the payload");
+
+static std::size_t block_bytes(const TlsfBlock *block){
+  return block->size & ~(std::size_t)(TLSF_ALIGN - 1);
+}
+
+static bool block_free(const TlsfBlock *block){
+  return block->size & TLSF_FREE;
+}
+
+static void *block_ptr(const TlsfBlock *block){
+  return (std::uint8_t *)block + TLSF_HEADER;
+}
+
+static TlsfBlock *block_from_ptr(const void *ptr){
+  return (TlsfBlock *)((std::uint8_t *)ptr - TLSF_HEADER);
+}
+
+static TlsfBlock *block_next(const TlsfBlock *block){
+  return (TlsfBlock *)((std::uint8_t *)block_ptr(block) + block_bytes(block));
+}
+
+/* Index of the highest and lowest set bit, x != 0. CLZ (and RBIT) on the M4 */
+static std::uint32_t tlsf_fls(std::size_t x){
+  if constexpr(sizeof(std::size_t) > sizeof(unsigned int)){
+    return (std::uint32_t)(63 - __builtin_clzll(x));      /* host */
+  }
+  else{
+    return (std::uint32_t)(31 - __builtin_clz((unsigned int)x));
+  }
+}
+
+static std::uint32_t tlsf_ffs(std::uint32_t x){
+  return (std::uint32_t)__builtin_ctz(x);
+}
+
+/* List a free block of size bytes goes into. Blocks too big for the last first level
+   (a pool grown past TLSF_BLOCK_MAX) all go in the very last list */
+static void mapping_insert(std::size_t size, std::uint32_t *fl, std::uint32_t *sl){
+  if(size < TLSF_SMALL_BLOCK){
+    *fl = 0;
+    *sl = (std::uint32_t)size / (TLSF_SMALL_BLOCK / TLSF_SL_COUNT);
+    return;
+  }
+  if(size >= TLSF_BLOCK_MAX){
+    *fl = TLSF_FL_COUNT - 1;
+    *sl = TLSF_SL_COUNT - 1;
+    return;
+  }
+  std::uint32_t f = tlsf_fls(size);
+  *sl = (std::uint32_t)(size >> (f - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT;
+  *fl = f - (TLSF_FL_SHIFT - 1);
+}
+
+/* First list whose every block is at least size bytes, size rounded up to the list's lower
+   bound. false if that's past the last list */
+static bool mapping_search(std::size_t size, std::uint32_t *fl, std::uint32_t *sl){
+  if(size >= TLSF_SMALL_BLOCK){
+    size += ((std::size_t)1 << (tlsf_fls(size) - TLSF_SL_LOG2)) - 1;
+    if(size >= TLSF_BLOCK_MAX){
+      return false;
+    }
+  }
+  mapping_insert(size, fl, sl);
+  return true;
+}
+
+/* Head of the first non-empty list at or after [fl][sl] */
+static TlsfBlock *search_suitable(Tlsf *tlsf, std::uint32_t *fl, std::uint32_t *sl){
+  std::uint32_t sl_map = tlsf->sl_bitmap[*fl] & (~0U << *sl);
+  if(0 == sl_map){
+    std::uint32_t fl_map = tlsf->fl_bitmap & (~0U << (*fl + 1));
+    if(0 == fl_map){
+      return nullptr;
+    }
+    *fl = tlsf_ffs(fl_map);
+    sl_map = tlsf->sl_bitmap[*fl];
+  }
+  *sl = tlsf_ffs(sl_map);
+  return tlsf->free[*fl][*sl];
+}
+
+static void insert_free(Tlsf *tlsf, TlsfBlock *block){
+  std::uint32_t fl, sl;
+  mapping_insert(block_bytes(block), &fl, &sl);
+
+  TlsfBlock *head = tlsf->free[fl][sl];
+  block->next_free = head;
+  block->prev_free = nullptr;
+  if(nullptr != head){
+    head->prev_free = block;
+  }
+  tlsf->free[fl][sl] = block;
+  tlsf->fl_bitmap |= 1U << fl;
+  tlsf->sl_bitmap[fl] |= 1U << sl;
+  tlsf->free_bytes += block_bytes(block);
+}
+
+static void remove_free(Tlsf *tlsf, TlsfBlock *block, std::uint32_t fl, std::uint32_t sl){
+  tlsf->free_bytes -= block_bytes(block);
+  if(nullptr != block->next_free){
+    block->next_free->prev_free = block->prev_free;
+  }
+  if(nullptr != block->prev_free){
+    block->prev_free->next_free = block->next_free;
+    return;
+  }
+
+  tlsf->free[fl][sl] = block->next_free;
+  if(nullptr == block->next_free){
+    tlsf->sl_bitmap[fl] &= ~(1U << sl);
+    if(0 == tlsf->sl_bitmap[fl]){
+      tlsf->fl_bitmap &= ~(1U << fl);
+    }
+  }
+}
+
+static void remove_block(Tlsf *tlsf, TlsfBlock *block){
+  std::uint32_t fl, sl;
+  mapping_insert(block_bytes(block), &fl, &sl);
+  remove_free(tlsf, block, fl, sl);
+}
+
+/* next (physically after block) disappears into block, block keeps its free bit */
+static void absorb(TlsfBlock *block, TlsfBlock *next){
+  block->size += TLSF_HEADER + block_bytes(next);
+  block_next(block)->prev_phys = block;
+}
+
+/* Give everything in the used block past size bytes back as a free block, merged with
+   the next block if that one is free. Nothing happens if the tail is too small */
+static void block_trim(Tlsf *tlsf, TlsfBlock *block, std::size_t size){
+  std::size_t bytes = block_bytes(block);
+  if(bytes < size + TLSF_HEADER + TLSF_BLOCK_MIN){
+    return;
+  }
+
+  TlsfBlock *rest = (TlsfBlock *)((std::uint8_t *)block_ptr(block) + size);
+  rest->prev_phys = block;
+  rest->size = (bytes - size - TLSF_HEADER) | TLSF_FREE;
+  block->size = size;
+  block_next(rest)->prev_phys = rest;
+
+  TlsfBlock *next = block_next(rest);
+  if(block_free(next)){
+    remove_block(tlsf, next);
+    absorb(rest, next);
+  }
+  insert_free(tlsf, rest);
+}
+
+/* Request size as a block size, 0 if it can never be served */
+static std::size_t tlsf_adjust(std::size_t size){
+  if(size >= TLSF_BLOCK_MAX){
+    return 0;
+  }
+  size = (size + TLSF_ALIGN - 1) & ~(std::size_t)(TLSF_ALIGN - 1);
+  return (size < TLSF_BLOCK_MIN) ? TLSF_BLOCK_MIN : size;
+}
+
+static void used_add(Tlsf *tlsf, const TlsfBlock *block){
+  tlsf->used_bytes += block_bytes(block);
+  tlsf->used_blocks++;
+  tlsf->used_peak = (tlsf->used_bytes > tlsf->used_peak) ? tlsf->used_bytes : tlsf->used_peak;
+}
+
+/* Take a free block of at least size bytes off its list, marked used */
+static TlsfBlock *tlsf_take(Tlsf *tlsf, std::size_t size){
+  std::uint32_t fl, sl;
+  if(!mapping_search(size, &fl, &sl)){
+    return nullptr;
+  }
+
+  TlsfBlock *block = search_suitable(tlsf, &fl, &sl);
+  if(nullptr == block){
+    return nullptr;
+  }
+  remove_free(tlsf, block, fl, sl);
+  block->size &= ~(std::size_t)TLSF_FREE;
+  return block;
+}
+
+void tlsf_init(Tlsf *tlsf){
+  std::memset(tlsf, 0, sizeof(*tlsf));
+}
+
+void *tlsf_add_pool(Tlsf *tlsf, void *mem, std::size_t bytes){
+  std::uintptr_t start = ((std::uintptr_t)mem + TLSF_ALIGN - 1) & ~(std::uintptr_t)(TLSF_ALIGN - 1);
+  std::uintptr_t end = ((std::uintptr_t)mem + bytes) & ~(std::uintptr_t)(TLSF_ALIGN - 1);
+  if((end <= start) || (end - start < 2 * TLSF_HEADER + TLSF_BLOCK_MIN)){
+    return nullptr;
+  }
+
+  TlsfBlock *block = (TlsfBlock *)start;
+  block->prev_phys = nullptr;
+  block->size = (end - start - 2 * TLSF_HEADER) | TLSF_FREE;
+
+  TlsfBlock *sentinel = block_next(block);
+  sentinel->prev_phys = block;
+  sentinel->size = 0;
+
+  insert_free(tlsf, block);
+  return (void *)end;
+}
+
+void *tlsf_extend_pool(Tlsf *tlsf, void *pool_end, std::size_t bytes){
+  if((0 != (bytes % TLSF_ALIGN)) || (bytes < TLSF_HEADER + TLSF_BLOCK_MIN)){
+    return nullptr;
+  }
+
+  /* The old sentinel becomes the header of the new space */
+  TlsfBlock *block = (TlsfBlock *)((std::uint8_t *)pool_end - TLSF_HEADER);
+  block->size = (bytes - TLSF_HEADER) | TLSF_FREE;
+
+  TlsfBlock *sentinel = block_next(block);
+  sentinel->prev_phys = block;
+  sentinel->size = 0;
+
+  TlsfBlock *prev = block->prev_phys;
+  if((nullptr != prev) && block_free(prev)){
+    remove_block(tlsf, prev);
+    absorb(prev, block);
+    block = prev;
+  }
+  insert_free(tlsf, block);
+  return (std::uint8_t *)pool_end + bytes;
+}
+
+void *tlsf_malloc(Tlsf *tlsf, std::size_t size){
+  std::size_t adjust = tlsf_adjust(size);
+  if(0 == adjust){
+    return nullptr;
+  }
+
+  TlsfBlock *block = tlsf_take(tlsf, adjust);
+  if(nullptr == block){
+    return nullptr;
+  }
+  block_trim(tlsf, block, adjust);
+  used_add(tlsf, block);
+  return block_ptr(block);
+}
+
+void *tlsf_memalign(Tlsf *tlsf, std::size_t align, std::size_t size){
+  if(align <= TLSF_ALIGN){
+    return tlsf_malloc(tlsf, size);
+  }
+  std::size_t adjust = tlsf_adjust(size);
+  if((0 != (align & (align - 1))) || (0 == adjust) || (align >= TLSF_BLOCK_MAX)){
+    return nullptr;
+  }
+
+  /* Worst case the aligned pointer is a whole gap block plus align - 1 in */
+  const std::size_t gap_min = TLSF_HEADER + TLSF_BLOCK_MIN;
+  TlsfBlock *block = tlsf_take(tlsf, adjust + gap_min + align);
+  if(nullptr == block){
+    return nullptr;
+  }
+
+  std::uintptr_t ptr = (std::uintptr_t)block_ptr(block);
+  if(0 != (ptr & (align - 1))){
+    /* Cut off the front as a free block of its own. The block before can't be free, free
+       neighbours are always merged */
+    std::uintptr_t aligned = (ptr + gap_min + align - 1) & ~(std::uintptr_t)(align - 1);
+    TlsfBlock *front = block;
+    block = (TlsfBlock *)(aligned - TLSF_HEADER);
+    block->prev_phys = front;
+    block->size = block_bytes(front) - (aligned - ptr);
+    block_next(block)->prev_phys = block;
+    front->size = (aligned - ptr - TLSF_HEADER) | TLSF_FREE;
+    insert_free(tlsf, front);
+  }
+
+  block_trim(tlsf, block, adjust);
+  used_add(tlsf, block);
+  return block_ptr(block);
+}
+
+void *tlsf_realloc(Tlsf *tlsf, void *ptr, std::size_t size){
+  if(nullptr == ptr){
+    return tlsf_malloc(tlsf, size);
+  }
+  if(0 == size){
+    tlsf_free(tlsf, ptr);
+    return nullptr;
+  }
+
+  std::size_t adjust = tlsf_adjust(size);
+  if(0 == adjust){
+    return nullptr;
+  }
+
+  TlsfBlock *block = block_from_ptr(ptr);
+  std::size_t bytes = block_bytes(block);
+  if(adjust > bytes){
+    TlsfBlock *next = block_next(block);
+    if(!block_free(next) || (bytes + TLSF_HEADER + block_bytes(next) < adjust)){
+      void *moved = tlsf_malloc(tlsf, size);
+      if(nullptr != moved){
+        std::memcpy(moved, ptr, bytes);
+        tlsf_free(tlsf, ptr);
+      }
+      return moved;
+    }
+    remove_block(tlsf, next);
+    absorb(block, next);
+  }
+
+  block_trim(tlsf, block, adjust);
+  tlsf->used_bytes -= bytes;
+  tlsf->used_blocks--;
+  used_add(tlsf, block);
+  return ptr;
+}
+
+void tlsf_free(Tlsf *tlsf, void *ptr){
+  if(nullptr == ptr){
+    return;
+  }
+
+  TlsfBlock *block = block_from_ptr(ptr);
+  tlsf->used_bytes -= block_bytes(block);
+  tlsf->used_blocks--;
+  block->size |= TLSF_FREE;
+
+  TlsfBlock *prev = block->prev_phys;
+  if((nullptr != prev) && block_free(prev)){
+    remove_block(tlsf, prev);
+    absorb(prev, block);
+    block = prev;
+  }
+
+  TlsfBlock *next = block_next(block);
+  if(block_free(next)){
+    remove_block(tlsf, next);
+    absorb(block, next);
+  }
+  insert_free(tlsf, block);
+}
+
+std::size_t tlsf_block_size(const void *ptr){
+  return (nullptr == ptr) ? 0 : block_bytes(block_from_ptr(ptr));
+}
+
+void tlsf_stats(const Tlsf *tlsf, TlsfStats *stats){
+  stats->used = tlsf->used_bytes;
+  stats->used_peak = tlsf->used_peak;
+  stats->free = tlsf->free_bytes;
+  stats->used_blocks = tlsf->used_blocks;
+  stats->largest_free = 0;
+  stats->fragmentation = 0;
+  if(0 == tlsf->fl_bitmap){
+    return;
+  }
+
+  std::uint32_t fl = tlsf_fls(tlsf->fl_bitmap);
+  std::uint32_t sl = tlsf_fls(tlsf->sl_bitmap[fl]);
+  for(const TlsfBlock *b = tlsf->free[fl][sl]; nullptr != b; b = b->next_free){
+    stats->largest_free = (block_bytes(b) > stats->largest_free) ? block_bytes(b) : stats->largest_free;
+  }
+
+  /* Scaled down so free * 1000 fits 32 bits, no 64 bit divide on the target */
+  std::size_t free = stats->free;
+  std::size_t largest = stats->largest_free;
+  while(free > 0x3FFFFFU){
+    free >>= 1;
+    largest >>= 1;
+  }
+  stats->fragmentation = (std::uint32_t)(1000U - largest * 1000U / free);
+}
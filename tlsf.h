@@ -0,0 +1,98 @@
+#ifndef __TLSF_H
+#define __TLSF_H
+
+#include <cstdint>
+#include <cstddef>
+
+/*
+Two level segregated fit allocator (Masmano, Ripoll, Crespo, Real: "TLSF: a new dynamic
+memory allocator for real-time systems").
+
+Free blocks are kept in TLSF_FL_COUNT x TLSF_SL_COUNT lists. The first level splits sizes
+into powers of 2, the second level splits every power of 2 into TLSF_SL_COUNT equal ranges,
+and a bitmap per level says which lists are non-empty. malloc rounds the request up to the
+next list boundary, so the head of any non-empty list at or above it fits, and finding that
+list is two find-first-set operations on the bitmaps. free merges with the physical
+neighbours through a boundary tag. Both are O(1), no loop depends on the number of blocks.
+
+Plain C++, no target headers, so it builds for the host too. Not thread safe, heap.cpp puts
+it behind __malloc_lock (syslock.h).
+
+Memory is handed over in pools. A pool that starts exactly where an earlier one ended can be
+glued on with tlsf_extend_pool, so a heap grown with sbrk stays one run of blocks.
+
+  static std::uint8_t pool[16 * 1024];
+  Tlsf heap;
+  tlsf_init(&heap);
+  tlsf_add_pool(&heap, pool, sizeof(pool));
+  void *p = tlsf_malloc(&heap, 100);
+*/
+
+#define TLSF_ALIGN          8U      /* every pointer handed out, and every block size */
+#define TLSF_SL_LOG2        4U
+#define TLSF_SL_COUNT       (1U << TLSF_SL_LOG2)
+#define TLSF_FL_SHIFT       (TLSF_SL_LOG2 + 3U)          /* log2(TLSF_ALIGN) */
+#define TLSF_SMALL_BLOCK    (1U << TLSF_FL_SHIFT)        /* below this the first level is 0 */
+#define TLSF_FL_MAX         24U                          /* blocks up to 16M, covers the SDRAM */
+#define TLSF_FL_COUNT       (TLSF_FL_MAX - TLSF_FL_SHIFT + 1U)
+#define TLSF_BLOCK_MAX      (1U << TLSF_FL_MAX)
+
+/* Per block overhead: the block before this one (for merging) and this block's size */
+#define TLSF_HEADER         (2U * sizeof(void *))    /* 8 on the target */
+#define TLSF_BLOCK_MIN      (2U * sizeof(void *))    /* payload, room for the free list links */
+
+struct TlsfBlock;
+
+struct Tlsf {
+  std::uint32_t fl_bitmap;
+  std::uint32_t sl_bitmap[TLSF_FL_COUNT];
+  TlsfBlock *free[TLSF_FL_COUNT][TLSF_SL_COUNT];
+  /* Kept up to date by every call, a few adds each */
+  std::size_t used_bytes;
+  std::size_t used_peak;
+  std::size_t free_bytes;
+  std::uint32_t used_blocks;
+};
+
+/* Byte counts are block payloads, headers not included */
+struct TlsfStats {
+  std::size_t used;
+  std::size_t used_peak;
+  std::size_t free;
+  std::size_t largest_free;       /* biggest single allocation that could still succeed */
+  std::uint32_t used_blocks;
+  std::uint32_t fragmentation;    /* per mille of the free bytes not in the largest free block */
+};
+
+void tlsf_init(Tlsf *tlsf);
+
+/* Hand bytes at mem to the allocator. mem is aligned up, bytes down, to TLSF_ALIGN, and
+   2 * TLSF_HEADER go to the block headers. Returns the end of the pool (for
+   tlsf_extend_pool), nullptr if it's too small for a single block. There's no upper limit,
+   a block past TLSF_BLOCK_MAX is kept in the last free list */
+void *tlsf_add_pool(Tlsf *tlsf, void *mem, std::size_t bytes);
+
+/* The bytes right after the end of a pool became usable, grow that pool over them.
+   Returns the new end, nullptr if bytes isn't a multiple of TLSF_ALIGN or is less than a
+   header and a minimum block */
+void *tlsf_extend_pool(Tlsf *tlsf, void *pool_end, std::size_t bytes);
+
+/* nullptr if nothing fits, size 0 gets a minimum block */
+void *tlsf_malloc(Tlsf *tlsf, std::size_t size);
+
+/* align is a power of 2, anything up to TLSF_ALIGN is the same as tlsf_malloc */
+void *tlsf_memalign(Tlsf *tlsf, std::size_t align, std::size_t size);
+
+/* Grows in place into a free neighbour when it can, nullptr (and ptr untouched) if there
+   is no room. realloc(ptr, 0) frees and returns nullptr */
+void *tlsf_realloc(Tlsf *tlsf, void *ptr, std::size_t size);
+
+void tlsf_free(Tlsf *tlsf, void *ptr);
+
+/* Usable bytes behind ptr, at least what was asked for */
+std::size_t tlsf_block_size(const void *ptr);
+
+/* Only the largest free block needs a look at the free lists, the top non-empty one */
+void tlsf_stats(const Tlsf *tlsf, TlsfStats *stats);
+
+#endif